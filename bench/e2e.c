@@ -0,0 +1,334 @@
+/**
+ * End to end benchmark of the shell's main loop.
+ * Each scenario generates a script and runs it two ways for every launch backend:
+ *    lockstep Each line is written after the previous one finished so the
+ *        latency from submission to the prompt(or to the background pid for
+ *        background scenarios) can be measured. Background processes also
+ *        get their latency from submission to the reap being reported.
+ *    batch The whole script is read from a file as fast as the shell can
+ *        run it to measure commands/sec.
+ * Peak RSS is the shell's ru_maxrss from wait4. Results are written as JSON.
+ * Run everything with bench/run.sh or by hand:
+ *
+ *    gcc -std=gnu11 -O2 -o bench/e2e bench/e2e.c
+ *    ./bench/e2e path/to/smallsh [commands per scenario] [out.json]
+**/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// Give up on a scenario if the shell stops responding for this long.
+#define E2E_TIMEOUT_MS 10000
+
+/**
+ * Writes line i of a scenario into line, dir is a scratch directory.
+**/
+typedef void (*line_generator)(char* line, size_t size, size_t i, const char* dir);
+
+typedef struct scenario {
+    const char* name;
+    line_generator Generate;
+    bool background;
+} scenario;
+
+/**
+ * The output of the shell not yet matched against a marker.
+**/
+typedef struct shell_output {
+    int fd;
+    char buffer[1 << 16];
+    size_t length;
+} shell_output;
+
+static const char* shellPath;
+static bool first = true;
+static char scratch[] = "/tmp/smallsh-bench-XXXXXX";
+
+static uint64_t Now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void GenerateBuiltins(char* line, size_t size, size_t i, const char* dir) {
+    switch (i % 3) {
+        case 0: snprintf(line, size, "cd %s\n", dir); break;
+        case 1: snprintf(line, size, "export BENCH_%zu=$$\n", i % 64); break;
+        default: snprintf(line, size, "status\n"); break;
+    }
+}
+
+static void GenerateTrue(char* line, size_t size, size_t i, const char* dir) {
+    // Alternate an absolute path with a PATH lookup.
+    snprintf(line, size, i % 2 ? "true\n" : "/bin/true\n");
+}
+
+static void GenerateBackground(char* line, size_t size, size_t i, const char* dir) {
+    snprintf(line, size, "/bin/true &\n");
+}
+
+static void GenerateRedirection(char* line, size_t size, size_t i, const char* dir) {
+    if (i % 2) snprintf(line, size, "cat < %s/in > %s/out%zu\n", dir, dir, i % 16);
+    else snprintf(line, size, "echo redirected $$ > %s/out%zu\n", dir, i % 16);
+}
+
+static const scenario scenarios[] = {
+    {"builtins", GenerateBuiltins, false},
+    {"true", GenerateTrue, false},
+    {"background", GenerateBackground, true},
+    {"redirection", GenerateRedirection, false}
+};
+
+static const char* backends[] = {"fork", "vfork", "spawn", "zygote"};
+
+/**
+ * Start the shell with stdin reading from inFD and stdout written to outFD.
+ * An interactive shell prints its prompts even though stdin is not a terminal.
+**/
+static pid_t StartShell(const char* backend, int inFD, int outFD, bool interactive) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(inFD, 0);
+        dup2(outFD, 1);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, 2);
+        if (interactive) execl(shellPath, shellPath, "-i", "-l", backend, (char*) NULL);
+        else execl(shellPath, shellPath, "-l", backend, (char*) NULL);
+        _exit(127);
+    }
+    return pid;
+}
+
+/**
+ * Read more of the shell's output waiting at most timeout ms.
+ * Returns false on end of file or timeout.
+**/
+static bool ReadOutput(shell_output* output, int timeout) {
+    struct pollfd readable = {output->fd, POLLIN, 0};
+    if (poll(&readable, 1, timeout) <= 0) return false;
+    if (output->length == sizeof(output->buffer) - 1) output->length = 0;
+    ssize_t bytes = read(output->fd, output->buffer + output->length, sizeof(output->buffer) - 1 - output->length);
+    if (bytes <= 0) return false;
+    output->length += bytes;
+    output->buffer[output->length] = 0;
+    return true;
+}
+
+/**
+ * Record the reap time of every "The process N ..." report in the output.
+ * pids and submitted hold the background pids and when they were submitted.
+**/
+static size_t MatchReaps(shell_output* output, pid_t* pids, uint64_t* submitted, uint64_t* reaped, size_t count) {
+    size_t matched = 0;
+    char* report;
+    while ((report = strstr(output->buffer, "The process ")) && strchr(report, '\n')) {
+        pid_t pid = atoi(report + strlen("The process "));
+        for (size_t i = 0; i < count; i++) {
+            if (pids[i] == pid && reaped[i] == 0) {
+                reaped[i] = Now() - submitted[i];
+                matched++;
+                break;
+            }
+        }
+        // Only cut out the report since a background pid may be before it.
+        char* end = strchr(report, '\n') + 1;
+        output->length -= end - report;
+        memmove(report, end, output->buffer + output->length - report + 1);
+    }
+    return matched;
+}
+
+/**
+ * Wait for a prompt at the end of the output.
+**/
+static bool WaitPrompt(shell_output* output) {
+    while (true) {
+        char* newline = memrchr(output->buffer, '\n', output->length);
+        size_t tail = newline ? newline + 1 - output->buffer : 0;
+        size_t length = output->length - tail;
+        if (length >= 2 && memcmp(output->buffer + output->length - 2, ": ", 2) == 0
+                && (length == 2 || output->buffer[output->length - 3] == ' ')) {
+            output->length = 0;
+            return true;
+        }
+        if (!ReadOutput(output, E2E_TIMEOUT_MS)) return false;
+    }
+}
+
+/**
+ * Wait for "The background process is N." and return N.
+ * Only that line is taken out of the output so reports stay for MatchReaps.
+**/
+static pid_t WaitBackgroundPid(shell_output* output) {
+    while (true) {
+        char* started = strstr(output->buffer, "The background process is ");
+        if (started && strchr(started, '\n')) {
+            pid_t pid = atoi(started + strlen("The background process is "));
+            char* end = strchr(started, '\n') + 1;
+            output->length -= end - started;
+            memmove(started, end, output->buffer + output->length - started + 1);
+            return pid;
+        }
+        if (!ReadOutput(output, E2E_TIMEOUT_MS)) return -1;
+    }
+}
+
+/**
+ * Start a new JSON result after the previous one.
+**/
+static void Separate(FILE* out) {
+    fprintf(out, first ? "\n" : ",\n");
+    first = false;
+}
+
+static int CompareU64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * The p-th percentile of sorted values in microseconds.
+**/
+static double Percentile(uint64_t* values, size_t count, double p) {
+    if (count == 0) return 0;
+    size_t index = (size_t) (p * (count - 1) + 0.5);
+    return values[index] / 1000.0;
+}
+
+/**
+ * Run a scenario one line at a time measuring the latency of each line.
+ * Returns false if the shell stopped responding.
+**/
+static bool RunLockstep(const scenario* s, const char* backend, size_t count, FILE* out) {
+    int in[2], outPipe[2];
+    if (pipe2(in, O_CLOEXEC) < 0 || pipe2(outPipe, O_CLOEXEC) < 0) return false;
+    pid_t shell = StartShell(backend, in[0], outPipe[1], true);
+    close(in[0]);
+    close(outPipe[1]);
+    shell_output* output = calloc(1, sizeof(shell_output));
+    output->fd = outPipe[0];
+    uint64_t* latency = calloc(count, sizeof(uint64_t));
+    uint64_t* submitted = calloc(count, sizeof(uint64_t));
+    uint64_t* reaped = calloc(count, sizeof(uint64_t));
+    pid_t* pids = calloc(count, sizeof(pid_t));
+    size_t done = 0, reaps = 0;
+    char line[512];
+    bool ok = WaitPrompt(output);
+    uint64_t start = Now();
+    for (; ok && done < count; done++) {
+        s->Generate(line, sizeof(line), done, scratch);
+        submitted[done] = Now();
+        if (write(in[1], line, strlen(line)) < 0) ok = false;
+        else if (s->background) ok = (pids[done] = WaitBackgroundPid(output)) > 0;
+        else ok = WaitPrompt(output);
+        latency[done] = Now() - submitted[done];
+        if (s->background) reaps += MatchReaps(output, pids, submitted, reaped, done + 1);
+    }
+    uint64_t elapsed = Now() - start;
+    // Background processes may still be waiting to be reaped.
+    while (ok && s->background && reaps < done) {
+        reaps += MatchReaps(output, pids, submitted, reaped, done);
+        if (reaps < done && !ReadOutput(output, E2E_TIMEOUT_MS)) break;
+    }
+    close(in[1]);
+    int status;
+    struct rusage usage;
+    wait4(shell, &status, 0, &usage);
+    close(outPipe[0]);
+
+    qsort(latency, done, sizeof(uint64_t), CompareU64);
+    Separate(out);
+    fprintf(out, "    {\"scenario\": \"%s\", \"backend\": \"%s\", \"mode\": \"lockstep\", \"commands\": %zu, \"commands_per_sec\": %.1f, "
+        "\"latency_p50_us\": %.1f, \"latency_p99_us\": %.1f, ",
+        s->name, backend, done, done / (elapsed / 1e9), Percentile(latency, done, 0.5), Percentile(latency, done, 0.99));
+    if (s->background) {
+        size_t measured = 0;
+        for (size_t i = 0; i < done; i++)
+            if (reaped[i] != 0) reaped[measured++] = reaped[i];
+        qsort(reaped, measured, sizeof(uint64_t), CompareU64);
+        fprintf(out, "\"reaped\": %zu, \"reap_p50_us\": %.1f, \"reap_p99_us\": %.1f, ", measured, Percentile(reaped, measured, 0.5), Percentile(reaped, measured, 0.99));
+    }
+    fprintf(out, "\"peak_rss_kb\": %ld, \"ok\": %s}", usage.ru_maxrss, ok ? "true" : "false");
+    free(output);
+    free(latency);
+    free(submitted);
+    free(reaped);
+    free(pids);
+    return ok;
+}
+
+/**
+ * Run a whole scenario script from a file as fast as the shell can read it.
+**/
+static void RunBatch(const scenario* s, const char* backend, size_t count, FILE* out) {
+    char path[64];
+    snprintf(path, sizeof(path), "%s/script", scratch);
+    FILE* script = fopen(path, "w");
+    char line[512];
+    for (size_t i = 0; i < count; i++) {
+        s->Generate(line, sizeof(line), i, scratch);
+        fputs(line, script);
+    }
+    fclose(script);
+    int in = open(path, O_RDONLY | O_CLOEXEC), null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    uint64_t start = Now();
+    pid_t shell = StartShell(backend, in, null, false);
+    int status;
+    struct rusage usage;
+    wait4(shell, &status, 0, &usage);
+    uint64_t elapsed = Now() - start;
+    close(in);
+    close(null);
+    Separate(out);
+    fprintf(out, "    {\"scenario\": \"%s\", \"backend\": \"%s\", \"mode\": \"batch\", \"commands\": %zu, \"commands_per_sec\": %.1f, "
+        "\"peak_rss_kb\": %ld, \"ok\": %s}",
+        s->name, backend, count, count / (elapsed / 1e9), usage.ru_maxrss, WIFEXITED(status) && WEXITSTATUS(status) == 0 ? "true" : "false");
+}
+
+int main(int argc, char* args[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s smallsh [commands per scenario] [out.json]\n", args[0]);
+        return 1;
+    }
+    shellPath = args[1];
+    // Keep the generated commands out of the user's history.
+    setenv("HISTFILE", "", 1);
+    size_t count = argc > 2 ? strtoul(args[2], NULL, 10) : 2000;
+    FILE* out = argc > 3 ? fopen(args[3], "w") : stdout;
+    if (out == NULL || mkdtemp(scratch) == NULL) {
+        fprintf(stderr, "Could not create the output or scratch directory.\n");
+        return 1;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "%s/in", scratch);
+    FILE* input = fopen(path, "w");
+    fputs("redirected input\n", input);
+    fclose(input);
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(out, "{\"results\": [");
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(*scenarios); i++) {
+        for (size_t j = 0; j < sizeof(backends) / sizeof(*backends); j++) {
+            RunLockstep(scenarios + i, backends[j], count, out);
+            RunBatch(scenarios + i, backends[j], count, out);
+            fflush(out);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    if (out != stdout) fclose(out);
+
+    char command[128];
+    snprintf(command, sizeof(command), "rm -rf %s", scratch);
+    return system(command) != 0;
+}
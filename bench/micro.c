@@ -0,0 +1,227 @@
+/**
+ * Microbenchmarks for the vector/, string/ and memory/ primitives.
+ * Every benchmark reports ns/op, heap allocations per op and heap bytes per op
+ *    as JSON so two runs can be compared.
+ * Allocations are counted by wrapping malloc and realloc at link time:
+ *
+ *    gcc -std=gnu11 -O2 -o bench/micro bench/micro.c vector/vector.c string/str.c \
+ *        memory/mem.c memory/manager.c -Wl,--wrap=malloc -Wl,--wrap=realloc -Wl,--wrap=calloc
+ *    ./bench/micro [out.json]
+ *
+ * The JSON is written to stdout when no file is given.
+**/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../memory/manager.h"
+#include "../memory/mem.h"
+#include "../string/str.h"
+#include "../vector/vector.h"
+
+// Run each benchmark until it has taken at least this long.
+#define BENCH_MIN_NS 50000000ULL
+
+static size_t allocations, allocatedBytes;
+
+void* __real_malloc(size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void* __real_calloc(size_t count, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    allocations++;
+    allocatedBytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    allocations++;
+    allocatedBytes += size;
+    return __real_realloc(ptr, size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    allocations++;
+    allocatedBytes += count * size;
+    return __real_calloc(count, size);
+}
+
+/**
+ * A benchmark body runs ops operations on a payload of size bytes or items.
+**/
+typedef void (*bench_body)(size_t ops, size_t size);
+
+static FILE* out;
+static bool first = true;
+static volatile size_t sink;
+
+static uint64_t Now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * Run body with a growing number of ops until it takes BENCH_MIN_NS
+ *    and write the per op results as one JSON object.
+**/
+static void Run(const char* name, bench_body body, size_t size) {
+    size_t ops = 1;
+    uint64_t elapsed;
+    size_t allocs, bytes;
+    body(1, size); // Warm up the caches and the allocator.
+    while (true) {
+        allocations = allocatedBytes = 0;
+        uint64_t start = Now();
+        body(ops, size);
+        elapsed = Now() - start;
+        allocs = allocations;
+        bytes = allocatedBytes;
+        if (elapsed >= BENCH_MIN_NS || ops >= (1ULL << 40)) break;
+        ops *= elapsed == 0 ? 100 : (BENCH_MIN_NS * 12 / 10) / elapsed + 1;
+    }
+    fprintf(out, "%s\n    {\"name\": \"%s\", \"size\": %zu, \"ops\": %zu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.4f, \"bytes_per_op\": %.2f}",
+        first ? "" : ",", name, size, ops, (double) elapsed / ops, (double) allocs / ops, (double) bytes / ops);
+    first = false;
+}
+
+/**
+ * Push size ints onto a new vector, one op per push.
+**/
+static void BenchPushBackVector(size_t ops, size_t size) {
+    for (size_t done = 0; done < ops;) {
+        vector v = ConstructVector(sizeof(int), NULL, NULL);
+        for (int i = 0; i < size && done < ops; i++, done++)
+            PushBackVector(&v, &i);
+        sink += v.length;
+        DestroyVector(&v);
+    }
+}
+
+/**
+ * Remove the front of a size long vector of ints and push it back, one op per pair.
+**/
+static void BenchRemoveVector(size_t ops, size_t size) {
+    vector v = ConstructVector(sizeof(int), NULL, NULL);
+    for (int i = 0; i < size; i++)
+        PushBackVector(&v, &i);
+    for (size_t i = 0; i < ops; i++) {
+        int front = ((int*) v.items)[0];
+        RemoveVector(&v, 0);
+        PushBackVector(&v, &front);
+    }
+    sink += v.length;
+    DestroyVector(&v);
+}
+
+static char payload[4096];
+
+/**
+ * Append a size char string to an empty string, one op per append.
+ * Sizes around 32 show the cost of leaving the inline buffer.
+**/
+static void BenchAppendCStr(size_t ops, size_t size) {
+    payload[size] = 0;
+    for (size_t i = 0; i < ops; i++) {
+        string s;
+        ConstructStr(&s, "");
+        AppendCStr(&s, payload);
+        sink += s.length;
+        DestroyStr(&s);
+    }
+    payload[size] = 'x';
+}
+
+/**
+ * Append a 4 char string to a string until it is size chars long, one op per append.
+**/
+static void BenchAppendCStrGrow(size_t ops, size_t size) {
+    for (size_t done = 0; done < ops;) {
+        string s;
+        ConstructStr(&s, "");
+        for (size_t length = 0; length < size && done < ops; length += 4, done++)
+            AppendCStr(&s, "abcd");
+        sink += s.length;
+        DestroyStr(&s);
+    }
+}
+
+/**
+ * Take the first half of a size char string into a new string, one op per SubString.
+**/
+static void BenchSubString(size_t ops, size_t size) {
+    payload[size] = 0;
+    string src;
+    ConstructStr(&src, payload);
+    for (size_t i = 0; i < ops; i++) {
+        string dest;
+        ConstructStr(&dest, "");
+        SubString(&dest, &src, 0, size / 2);
+        sink += dest.length;
+        DestroyStr(&dest);
+    }
+    DestroyStr(&src);
+    payload[size] = 'x';
+}
+
+/**
+ * Grow a heap block one byte at a time to size bytes, one op per ReallocProper.
+**/
+static void BenchReallocProper(size_t ops, size_t size) {
+    for (size_t done = 0; done < ops;) {
+        void* block = malloc(1);
+        for (size_t count = 2; count <= size && done < ops; count++, done++)
+            ReallocProper(NULL, &block, 1, count, count - 1, NULL);
+        sink += (uintptr_t) block;
+        free(block);
+    }
+}
+
+/**
+ * The same as BenchReallocProper but growing the last block of an arena in place.
+**/
+static void BenchReallocProperArena(size_t ops, size_t size) {
+    memory_manager manager;
+    InitMemoryManager(&manager);
+    for (size_t done = 0; done < ops;) {
+        void* block = Alloc(&manager, 1);
+        for (size_t count = 2; count <= size && done < ops; count++, done++)
+            ReallocProper(&manager, &block, 1, count, count - 1, NULL);
+        sink += (uintptr_t) block;
+        ResetMemoryManager(&manager);
+    }
+    DestroyMemoryManager(&manager);
+}
+
+int main(int argc, char* args[]) {
+    out = argc > 1 ? fopen(args[1], "w") : stdout;
+    if (out == NULL) {
+        fprintf(stderr, "Could not open file %s for output.\n", args[1]);
+        return 1;
+    }
+    memset(payload, 'x', sizeof(payload));
+    fprintf(out, "{\"benchmarks\": [");
+    size_t vectorSizes[] = {16, 1024, 65536};
+    size_t removeSizes[] = {16, 256, 4096};
+    size_t stringSizes[] = {8, 31, 32, 33, 64, 1024};
+    size_t growSizes[] = {32, 256, 4096};
+    for (size_t i = 0; i < sizeof(vectorSizes) / sizeof(*vectorSizes); i++)
+        Run("PushBackVector", BenchPushBackVector, vectorSizes[i]);
+    for (size_t i = 0; i < sizeof(removeSizes) / sizeof(*removeSizes); i++)
+        Run("RemoveVector", BenchRemoveVector, removeSizes[i]);
+    for (size_t i = 0; i < sizeof(stringSizes) / sizeof(*stringSizes); i++)
+        Run("AppendCStr", BenchAppendCStr, stringSizes[i]);
+    for (size_t i = 0; i < sizeof(growSizes) / sizeof(*growSizes); i++)
+        Run("AppendCStrGrow", BenchAppendCStrGrow, growSizes[i]);
+    for (size_t i = 0; i < sizeof(stringSizes) / sizeof(*stringSizes); i++)
+        Run("SubString", BenchSubString, stringSizes[i]);
+    for (size_t i = 0; i < sizeof(growSizes) / sizeof(*growSizes); i++) {
+        Run("ReallocProper", BenchReallocProper, growSizes[i]);
+        Run("ReallocProperArena", BenchReallocProperArena, growSizes[i]);
+    }
+    fprintf(out, "\n]}\n");
+    if (out != stdout) fclose(out);
+    return 0;
+}
@@ -0,0 +1,13 @@
+#!/bin/sh
+# Build the shell and both benchmarks then run them, writing the JSON results to bench/results/.
+# Usage: bench/run.sh [commands per e2e scenario]
+set -e
+cd "$(dirname "$0")/.."
+mkdir -p bench/results
+gcc -std=gnu11 -O2 -o bench/results/smallsh $(find . -name '*.c' -not -path './bench/*')
+gcc -std=gnu11 -O2 -o bench/results/micro bench/micro.c vector/vector.c string/str.c memory/mem.c memory/manager.c \
+    -Wl,--wrap=malloc -Wl,--wrap=realloc -Wl,--wrap=calloc
+gcc -std=gnu11 -O2 -o bench/results/e2e bench/e2e.c
+bench/results/micro bench/results/micro.json
+bench/results/e2e bench/results/smallsh "${1:-2000}" bench/results/e2e.json
+cat bench/results/e2e.json
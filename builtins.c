@@ -0,0 +1,890 @@
+#define _GNU_SOURCE
+#include "builtins.h"
+#include "trace.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pwd.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/**
+ * Parse a whole arg as an integer.
+ * @return False if the arg is not an integer.
+**/
+static bool ParseInteger(const char* arg, long long* value) {
+    char* end;
+    errno = 0;
+    *value = strtoll(arg, &end, 10);
+    return *arg != 0 && *end == 0 && errno == 0;
+}
+
+/**
+ * Parse a whole arg as a count, size or id which cannot be negative.
+ * @return False if the arg is not a non-negative integer.
+**/
+static bool ParseCount(const char* arg, size_t* value) {
+    long long n;
+    if (!ParseInteger(arg, &n) || n < 0) return false;
+    *value = n;
+    return true;
+}
+
+/**
+ * Perform the exit command.
+**/
+static int CommandExit(shell* sh, command* c) {
+    sh->running = false;
+    return 0;
+}
+
+/**
+ * Perform the status command printing how the last foreground process died.
+**/
+static int CommandStatus(shell* sh, command* c) {
+    if (WIFEXITED(sh->status)) printf("The last foreground process exited normally with exit code %d.\n", WEXITSTATUS(sh->status));
+    else printf("The last foreground process was terminated by signal %d.\n", WTERMSIG(sh->status));
+    return 0;
+}
+
+/**
+ * Perform the jobs command listing the running background jobs.
+**/
+static int CommandJobs(shell* sh, command* c) {
+    PrintJobs(&sh->jobs);
+    return 0;
+}
+
+/**
+ * Perform the cd command using chdir.
+**/
+static int CommandCD(shell* sh, command* c) {
+    const char* dir;
+    if (c->args.length > 0) {
+        dir = ((string*) c->args.items)[0].str;
+    } else {
+        dir = GetVariable(&sh->vars, "HOME", 4);
+        if (dir == NULL) dir = getpwuid(getuid())->pw_dir;
+    }
+    if (chdir(dir) < 0) {
+        printf("No such directory %s.\n", dir);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Perform the export command. Each NAME=VALUE arg sets and exports
+ *    a variable and each NAME arg exports an existing variable.
+**/
+static int CommandExport(shell* sh, command* c) {
+    int status = 0;
+    for (size_t i = 0; i < c->args.length; i++) {
+        string* arg = ((string*) c->args.items) + i;
+        char* equals = memchr(arg->str, '=', arg->length);
+        size_t nameLength = equals ? equals - arg->str : arg->length;
+        if (!IsVariableName(arg->str, nameLength)) {
+            printf("Invalid variable name %s.\n", arg->str);
+            status = 1;
+        } else if (equals) {
+            SetVariable(&sh->vars, arg->str, nameLength, equals + 1, true);
+        } else if (!ExportVariable(&sh->vars, arg->str, nameLength)) {
+            SetVariable(&sh->vars, arg->str, nameLength, "", true);
+        }
+    }
+    return status;
+}
+
+/**
+ * Perform the unset command removing each named variable.
+**/
+static int CommandUnset(shell* sh, command* c) {
+    for (size_t i = 0; i < c->args.length; i++) {
+        string* arg = ((string*) c->args.items) + i;
+        UnsetVariable(&sh->vars, arg->str, arg->length);
+    }
+    return 0;
+}
+
+/**
+ * Perform the stats command. With no args every command is printed,
+ *    -r forgets the stats and each name arg prints that command.
+**/
+static int CommandStats(shell* sh, command* c) {
+    if (c->args.length == 0) PrintStats(&sh->jobs.stats, NULL);
+    for (size_t i = 0; i < c->args.length; i++) {
+        string* arg = ((string*) c->args.items) + i;
+        if (strcmp(arg->str, "-r") == 0) ClearStats(&sh->jobs.stats);
+        else PrintStats(&sh->jobs.stats, arg->str);
+    }
+    return 0;
+}
+
+/**
+ * Perform the trace command. trace on and trace off start and stop
+ *    recording, trace writes the events to the -t file and trace file
+ *    writes them to file.
+**/
+static int CommandTrace(shell* sh, command* c) {
+    const char* arg = c->args.length > 0 ? ((string*) c->args.items)[0].str : NULL;
+    if (arg && strcmp(arg, "on") == 0) {
+        if (StartTrace()) return 0;
+        printf("Could not start tracing.\n");
+    } else if (arg && strcmp(arg, "off") == 0) {
+        StopTrace();
+        return 0;
+    } else if (GTrace == NULL) {
+        printf("Tracing is off, start it with trace on.\n");
+    } else if ((arg = arg ? arg : sh->traceFile) == NULL) {
+        printf("Usage: trace [on|off|file]\n");
+        return 2;
+    } else if (DumpTrace(arg)) {
+        return 0;
+    } else {
+        printf("Could not write the trace to %s.\n", arg);
+    }
+    return 1;
+}
+
+/**
+ * Perform the hash command. With no args the cached command locations are
+ *    listed, -r forgets them and the cached directory listings, -d prints
+ *    the directory cache and each name arg is looked up and cached.
+**/
+static int CommandHash(shell* sh, command* c) {
+    int status = 0;
+    if (c->args.length == 0) PrintPathCache(&sh->paths);
+    for (size_t i = 0; i < c->args.length; i++) {
+        string* arg = ((string*) c->args.items) + i;
+        if (strcmp(arg->str, "-r") == 0) {
+            ClearPathCache(&sh->paths);
+            ClearDirCache(&sh->dirs);
+        } else if (strcmp(arg->str, "-d") == 0) {
+            PrintDirCache(&sh->dirs);
+        } else if (LookupPath(&sh->paths, arg->str, GetSearchPath(sh)) == NULL) {
+            printf("No such command %s in PATH.\n", arg->str);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+/**
+ * Perform the history command. With no args every entry is listed,
+ *    history n lists the newest n and history -s prefix prints the
+ *    newest entry starting with prefix.
+**/
+static int CommandHistory(shell* sh, command* c) {
+    string* args = c->args.items;
+    size_t n;
+    if (c->args.length == 2 && strcmp(args[0].str, "-s") == 0) {
+        n = FindHistory(&sh->history, args[1].str, args[1].length);
+        string entry;
+        ConstructStr(&entry, "");
+        bool found = n > 0 && GetHistory(&sh->history, n, &entry) > 0;
+        if (found) printf("%5zu  %s\n", n, entry.str);
+        DestroyStr(&entry);
+        if (!found) return 1;
+    } else if (c->args.length == 0) {
+        PrintHistory(&sh->history, 0);
+    } else if (c->args.length == 1 && ParseCount(args[0].str, &n)) {
+        PrintHistory(&sh->history, n);
+    } else {
+        printf("Usage: history [n] [-s prefix]\n");
+        return 2;
+    }
+    return 0;
+}
+
+/**
+ * Perform the output command. With no args the captured jobs are listed,
+ *    -c bytes captures the output of new background jobs in a buffer of that
+ *    many bytes per job, 0 turning it off, and output [-t n] job prints the
+ *    output kept for a job id or pid, or only its last n lines.
+**/
+static int CommandOutput(shell* sh, command* c) {
+    string* args = c->args.items;
+    size_t number, lines = 0;
+    if (c->args.length == 2 && strcmp(args[0].str, "-c") == 0 && ParseCount(args[1].str, &number)) {
+        sh->captures.size = number;
+    } else if ((c->args.length == 1 || (c->args.length == 3 && strcmp(args[0].str, "-t") == 0 && ParseCount(args[1].str, &lines)))
+            && ParseCount(args[c->args.length - 1].str, &number)) {
+        string* job = args + c->args.length - 1;
+        if (!PrintCapture(&sh->captures, number, lines)) {
+            printf("No output was captured for %s.\n", job->str);
+            return 1;
+        }
+    } else if (c->args.length == 0) {
+        PrintCaptures(&sh->captures);
+    } else {
+        printf("Usage: output [-c bytes] [-t n] [job]\n");
+        return 2;
+    }
+    return 0;
+}
+
+/**
+ * Perform the queue command. With no args the queue is listed
+ *    and -n sets the max number of running background jobs.
+**/
+static int CommandQueue(shell* sh, command* c) {
+    string* args = c->args.items;
+    size_t limit;
+    if (c->args.length == 2 && strcmp(args[0].str, "-n") == 0 && ParseCount(args[1].str, &limit)) {
+        sh->queue.limit = limit;
+        StartQueuedJobs(sh);
+    } else if (c->args.length > 0) {
+        printf("Usage: queue [-n max background jobs]\n");
+        return 2;
+    } else {
+        PrintJobQueue(&sh->queue, sh->jobs.backgroundJobs);
+    }
+    return 0;
+}
+
+/**
+ * Perform the prio command. prio n sets the priority of new background
+ *    jobs and prio n ticket... changes the priority of queued jobs.
+**/
+static int CommandPrio(shell* sh, command* c) {
+    string* args = c->args.items;
+    if (c->args.length == 0) {
+        printf("New background jobs have priority %d.\n", sh->queue.priority);
+        return 0;
+    }
+    long long priority;
+    size_t ticket;
+    bool valid = ParseInteger(args[0].str, &priority) && priority >= INT_MIN && priority <= INT_MAX;
+    for (size_t i = 1; valid && i < c->args.length; i++) valid = ParseCount(args[i].str, &ticket);
+    if (!valid) {
+        printf("Usage: prio [n [ticket...]]\n");
+        return 2;
+    }
+    int status = 0;
+    if (c->args.length == 1) sh->queue.priority = priority;
+    for (size_t i = 1; i < c->args.length; i++) {
+        ParseCount(args[i].str, &ticket);
+        if (!PrioritizeJob(&sh->queue, ticket, priority)) {
+            printf("No queued job %s.\n", args[i].str);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+/**
+ * Print the placement policy and the CPUs every running background process may run on.
+**/
+static void PrintAffinity(shell* sh) {
+    char list[256];
+    placement* p = &sh->placement;
+    FormatCPUList(&p->cpus, list, sizeof(list));
+    if (p->policy == PLACE_NONE) printf("Background jobs are not placed.\n");
+    else printf("Background jobs are placed %s %s with NUMA binding %s.\n", p->policy == PLACE_CPUS ? "on CPUs" : "by",
+        p->policy == PLACE_CPUS ? list : GetPlacementName(p), p->numa ? "on" : "off");
+    size_t index = 0;
+    job* j;
+    cpu_mask cpus;
+    while ((j = NextMap(&sh->jobs.jobs, &index))) {
+        if (!j->background || j->state != JOB_RUNNING || !GetAffinity(j->pid, &cpus)) continue;
+        FormatCPUList(&cpus, list, sizeof(list));
+        printf("[%zu] %d %s on CPUs %s\n", j->id, j->pid, j->name.str, list);
+    }
+}
+
+/**
+ * Perform the affinity command. With no args the placement policy and the CPUs of
+ *    background processes are listed. -p sets the policy to none, round-robin,
+ *    least-loaded or a CPU list like 0-3,8 and -n on also binds the memory of
+ *    placed jobs to the NUMA nodes of their CPUs.
+**/
+static int CommandAffinity(shell* sh, command* c) {
+    string* args = c->args.items;
+    if (c->args.length == 0) {
+        PrintAffinity(sh);
+        return 0;
+    }
+    for (size_t i = 0; i < c->args.length; i += 2) {
+        bool valid = i + 1 < c->args.length;
+        if (valid && strcmp(args[i].str, "-p") == 0) valid = SetPlacementPolicy(&sh->placement, args[i + 1].str);
+        else if (valid && strcmp(args[i].str, "-n") == 0 && strcmp(args[i + 1].str, "on") == 0) sh->placement.numa = true;
+        else if (valid && strcmp(args[i].str, "-n") == 0 && strcmp(args[i + 1].str, "off") == 0) sh->placement.numa = false;
+        else valid = false;
+        if (!valid) {
+            printf("Usage: affinity [-p none|round-robin|least-loaded|cpu list] [-n on|off]\n");
+            return 2;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read the next item for parallel from items or from the shell's input if items is NULL.
+ * The newline is removed. Returns the length or 0 once the items run out.
+**/
+static size_t NextItem(shell* sh, FILE* items, string* item) {
+    char chunk[256];
+    do {
+        SetCStr(item, "");
+        // Items of any length are read from a file a chunk at a time.
+        while (items && fgets(chunk, sizeof(chunk), items)) {
+            AppendCStr(item, chunk);
+            if (item->str[item->length - 1] == '\n') break;
+        }
+        // The shell's input is read without prompts or idle work between items.
+        if (!items) ReadLine(sh, item);
+        if (item->length == 0) return 0;
+        if (item->str[item->length - 1] == '\n') item->str[--item->length] = 0;
+    } while (item->length == 0);
+    return item->length;
+}
+
+/**
+ * Build the command parallel runs for one item in manager.
+ * Every "{}" in the template words is replaced by the item. If there
+ *    is none the item is passed as the last arg like xargs.
+ * The worker reads /dev/null so it cannot eat the shell's input.
+ * line is set to the worker's command line for the job table.
+**/
+static void ConstructWorker(command* worker, string* template, size_t count, char* item, string* line, memory_manager* manager) {
+    ConstructEmptyCommand(worker, manager);
+    SetCStr(&worker->inOut[0], "/dev/null");
+    ConstructManagedStr(line, "", manager);
+    bool substituted = false;
+    size_t itemLength = strlen(item);
+    for (size_t i = 0; i <= count; i++) {
+        string word;
+        if (i == count) {
+            if (substituted) break;
+            ConstructStrView(&word, item, itemLength, manager);
+        } else if (strstr(template[i].str, "{}") == NULL) {
+            ConstructStrView(&word, template[i].str, template[i].length, manager);
+        } else {
+            ConstructManagedStr(&word, "", manager);
+            const char* start = template[i].str, *brace;
+            while ((brace = strstr(start, "{}"))) {
+                AppendCStrN(&word, start, brace - start);
+                AppendCStrN(&word, item, itemLength);
+                start = brace + 2;
+            }
+            AppendCStr(&word, start);
+            substituted = true;
+        }
+        if (i > 0) AppendCStrN(line, " ", 1);
+        AppendCStrN(line, word.str, word.length);
+        if (i == 0) {
+            DestroyStr(&worker->commandName);
+            worker->commandName = word;
+            CopyConstructStr(&worker->commandName, &worker->commandName);
+        } else {
+            PushBackVector(&worker->args, &word);
+        }
+    }
+}
+
+/**
+ * Remove the finished workers from running and add them to the totals.
+ * Returns the number of workers that finished.
+**/
+static size_t CollectWorkers(shell* sh, pid_t* running, size_t* active, size_t* failed, bool* interrupted) {
+    size_t finished = 0;
+    for (size_t i = 0; i < *active;) {
+        job* j = GetJob(&sh->jobs, running[i]);
+        if (j == NULL || j->state != JOB_DONE) {
+            i++;
+            continue;
+        }
+        if (!WIFEXITED(j->status) || WEXITSTATUS(j->status) != 0) (*failed)++;
+        if (WIFSIGNALED(j->status) && WTERMSIG(j->status) == SIGINT) *interrupted = true;
+        RemoveJob(&sh->jobs, running[i]);
+        running[i] = running[--*active];
+        finished++;
+    }
+    return finished;
+}
+
+/**
+ * Perform the parallel command: parallel [-P n] template...
+ * Runs the template once per line read from the '<' file or stdin keeping
+ *    up to n workers running, n defaults to the number of online CPUs.
+ * Workers are foreground jobs so SIGINT stops them and no more are started.
+ * Each worker is placed like a background job so they spread over the CPUs.
+ * "$?" is 0 if every worker exited with 0 and 123 otherwise, like xargs.
+**/
+static int CommandParallel(shell* sh, command* c) {
+    string* args = c->args.items;
+    size_t first = 0;
+    long long workers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (c->args.length >= 2 && strcmp(args[0].str, "-P") == 0) {
+        if (!ParseInteger(args[1].str, &workers)) workers = 0;
+        first = 2;
+    }
+    if (first == c->args.length || workers < 1 || c->stages.length > 0) {
+        printf("Usage: parallel [-P n] command [args...] [< file]\n");
+        return 1;
+    }
+    FILE* items = NULL;
+    if (c->inOut[0].length > 0 && (items = fopen(c->inOut[0].str, "r")) == NULL) {
+        printf("Could not open file %s for input.\n", c->inOut[0].str);
+        return 1;
+    }
+
+    pid_t* running = malloc(sizeof(pid_t) * workers);
+    size_t active = 0, total = 0, failed = 0;
+    bool interrupted = false, more = true;
+    string item;
+    ConstructStr(&item, "");
+    memory_manager work;
+    InitMemoryManager(&work);
+    launch_options options = {sh->backend, false, GetEnvironment(&sh->vars), &sh->paths, GetSearchPath(sh), &sh->zygotes, -1, -1, NULL, 0, sh};
+    struct pollfd signals = {sh->signalFD, POLLIN, 0};
+    while (more) {
+        more = !interrupted && NextItem(sh, items, &item) > 0;
+        if (more) {
+            command worker;
+            string line;
+            ConstructWorker(&worker, args + first, c->args.length - first, item.str, &line, &work);
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            cpu_mask cpus;
+            options.cpus = PlaceJob(&sh->placement, &cpus, &options.nodes) ? &cpus : NULL;
+            if (LaunchCommand(&worker, &options, running + active) == 1) {
+                AddJob(&sh->jobs, &worker, running + active, 1, &line, false, &start);
+                active++;
+            } else {
+                failed++;
+            }
+            total++;
+            DestroyCommand(&worker);
+            ResetMemoryManager(&work);
+        }
+        // Wait for a free worker, or for all of them once the items run out.
+        while (active > 0 && (active >= workers || !more)) {
+            if (CollectWorkers(sh, running, &active, &failed, &interrupted) > 0) continue;
+            poll(&signals, 1, -1);
+            HandleSignals(sh);
+        }
+    }
+    DestroyMemoryManager(&work);
+    DestroyStr(&item);
+    free(running);
+    if (items) fclose(items);
+    // End of file on a terminal only ends the items, not the shell.
+    else if (isatty(sh->inputFD)) sh->inputClosed = false;
+
+    if (failed > 0) printf("%zu of %zu commands failed.\n", failed, total);
+    fflush(stdout);
+    for (; sh->pendingToggles > 0; sh->pendingToggles--)
+        ToggleForegroundOnly(sh);
+    return failed > 0 ? 123 : 0;
+}
+
+/**
+ * Perform the echo command. -n as the first arg leaves off the newline.
+**/
+static int CommandEcho(shell* sh, command* c) {
+    string* args = c->args.items;
+    size_t first = c->args.length > 0 && strcmp(args[0].str, "-n") == 0;
+    for (size_t i = first; i < c->args.length; i++) {
+        if (i > first) putchar(' ');
+        fwrite(args[i].str, sizeof(char), args[i].length, stdout);
+    }
+    if (!first) putchar('\n');
+    return 0;
+}
+
+/**
+ * Perform the pwd command.
+**/
+static int CommandPWD(shell* sh, command* c) {
+    char path[PATH_MAX];
+    if (getcwd(path, sizeof(path)) == NULL) {
+        printf("Could not get the current directory.\n");
+        return 1;
+    }
+    printf("%s\n", path);
+    return 0;
+}
+
+/**
+ * Perform the true command.
+**/
+static int CommandTrue(shell* sh, command* c) {
+    return 0;
+}
+
+/**
+ * Perform the false command.
+**/
+static int CommandFalse(shell* sh, command* c) {
+    return 1;
+}
+
+/**
+ * Evaluate a test expression of count args.
+ * @return 0 if it is true, 1 if it is false and 2 if it is invalid.
+**/
+static int Test(string* args, size_t count) {
+    if (count == 0) return 1;
+    if (strcmp(args[0].str, "!") == 0 && count > 1) {
+        int result = Test(args + 1, count - 1);
+        return result == 2 ? 2 : !result;
+    }
+    if (count == 1) return args[0].length == 0;
+    if (count == 2) {
+        const char* op = args[0].str, *arg = args[1].str;
+        struct stat info;
+        if (strcmp(op, "-n") == 0) return args[1].length == 0;
+        if (strcmp(op, "-z") == 0) return args[1].length != 0;
+        if (strcmp(op, "-r") == 0) return access(arg, R_OK) != 0;
+        if (strcmp(op, "-w") == 0) return access(arg, W_OK) != 0;
+        if (strcmp(op, "-x") == 0) return access(arg, X_OK) != 0;
+        if (strcmp(op, "-L") == 0) return lstat(arg, &info) != 0 || !S_ISLNK(info.st_mode);
+        bool exists = stat(arg, &info) == 0;
+        if (strcmp(op, "-e") == 0) return !exists;
+        if (strcmp(op, "-f") == 0) return !exists || !S_ISREG(info.st_mode);
+        if (strcmp(op, "-d") == 0) return !exists || !S_ISDIR(info.st_mode);
+        if (strcmp(op, "-s") == 0) return !exists || info.st_size == 0;
+        printf("test: unknown operator %s.\n", op);
+        return 2;
+    }
+    if (count == 3) {
+        const char* op = args[1].str;
+        if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0) return strcmp(args[0].str, args[2].str) != 0;
+        if (strcmp(op, "!=") == 0) return strcmp(args[0].str, args[2].str) == 0;
+        long long left, right;
+        if (!ParseInteger(args[0].str, &left) || !ParseInteger(args[2].str, &right)) {
+            printf("test: %s needs integers.\n", op);
+            return 2;
+        }
+        if (strcmp(op, "-eq") == 0) return !(left == right);
+        if (strcmp(op, "-ne") == 0) return !(left != right);
+        if (strcmp(op, "-lt") == 0) return !(left < right);
+        if (strcmp(op, "-le") == 0) return !(left <= right);
+        if (strcmp(op, "-gt") == 0) return !(left > right);
+        if (strcmp(op, "-ge") == 0) return !(left >= right);
+        printf("test: unknown operator %s.\n", op);
+        return 2;
+    }
+    printf("test: too many arguments.\n");
+    return 2;
+}
+
+/**
+ * Perform the test command, or the [ command which must end with ].
+**/
+static int CommandTest(shell* sh, command* c) {
+    size_t count = c->args.length;
+    if (c->commandName.str[0] == '[') {
+        if (count == 0 || strcmp(((string*) c->args.items)[count - 1].str, "]") != 0) {
+            printf("[: missing ].\n");
+            return 2;
+        }
+        count--;
+    }
+    return Test(c->args.items, count);
+}
+
+/**
+ * Print format once like printf(1) using args starting at next.
+ * Supports the \n, \t, \r, \\ and \0 escapes and the d, i, o, u, x, X, c, s
+ *    and % conversions with flags, width and precision. Missing args are
+ *    empty strings or 0.
+ * @return The index of the first arg not used.
+**/
+static size_t PrintFormat(const char* format, string* args, size_t count, size_t next) {
+    for (const char* f = format; *f; f++) {
+        if (*f == '\\' && f[1]) {
+            f++;
+            switch (*f) {
+                case 'n': putchar('\n'); break;
+                case 't': putchar('\t'); break;
+                case 'r': putchar('\r'); break;
+                case '0': putchar('\0'); break;
+                case '\\': putchar('\\'); break;
+                default: putchar('\\'); putchar(*f); break;
+            }
+            continue;
+        }
+        if (*f != '%') {
+            putchar(*f);
+            continue;
+        }
+        if (f[1] == '%') {
+            putchar('%');
+            f++;
+            continue;
+        }
+        // Copy the flags, width and precision then add ll before integer conversions.
+        char spec[32] = "%";
+        size_t length = 1;
+        const char* start = f++;
+        while (*f && strchr("-+ #0123456789.", *f) && length < sizeof(spec) - 4) spec[length++] = *f++;
+        const char* arg = next < count ? args[next].str : "";
+        switch (*f) {
+            case 'd':
+            case 'i':
+                spec[length++] = 'l';
+                spec[length++] = 'l';
+                spec[length++] = *f;
+                printf(spec, strtoll(arg, NULL, 0));
+                break;
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X':
+                spec[length++] = 'l';
+                spec[length++] = 'l';
+                spec[length++] = *f;
+                printf(spec, strtoull(arg, NULL, 0));
+                break;
+            case 'c':
+                spec[length++] = 'c';
+                printf(spec, *arg);
+                break;
+            case 's':
+                spec[length++] = 's';
+                printf(spec, arg);
+                break;
+            default: // Not a conversion so print it as is.
+                fwrite(start, sizeof(char), f - start + (*f != 0), stdout);
+                if (*f == 0) return next;
+                continue;
+        }
+        if (next < count) next++;
+    }
+    return next;
+}
+
+/**
+ * Perform the printf command. The format is reused until every arg is used.
+**/
+static int CommandPrintf(shell* sh, command* c) {
+    string* args = c->args.items;
+    if (c->args.length == 0) {
+        printf("Usage: printf format [args...]\n");
+        return 1;
+    }
+    size_t next = 1, used;
+    do {
+        used = next;
+        next = PrintFormat(args[0].str, args, c->args.length, next);
+    } while (next < c->args.length && next > used);
+    return 0;
+}
+
+/**
+ * The signals kill knows by name.
+**/
+static const struct { const char* name; int signal; } signalNames[] = {
+    {"HUP", SIGHUP}, {"INT", SIGINT}, {"QUIT", SIGQUIT}, {"KILL", SIGKILL}, {"USR1", SIGUSR1},
+    {"USR2", SIGUSR2}, {"PIPE", SIGPIPE}, {"ALRM", SIGALRM}, {"TERM", SIGTERM}, {"CHLD", SIGCHLD},
+    {"CONT", SIGCONT}, {"STOP", SIGSTOP}, {"TSTP", SIGTSTP}
+};
+
+/**
+ * Parse a signal number or name with or without SIG.
+ * @return The signal or -1 if it is not known.
+**/
+static int ParseSignal(const char* name) {
+    long long number;
+    if (ParseInteger(name, &number)) return number >= 0 && number < NSIG ? number : -1;
+    if (strncmp(name, "SIG", 3) == 0) name += 3;
+    for (size_t i = 0; i < sizeof(signalNames) / sizeof(*signalNames); i++)
+        if (strcmp(name, signalNames[i].name) == 0) return signalNames[i].signal;
+    return -1;
+}
+
+/**
+ * Perform the kill command: kill [-s signal | -signal] pid|%job...
+ * The signal defaults to SIGTERM and %job sends it to every process of a job.
+**/
+static int CommandKill(shell* sh, command* c) {
+    string* args = c->args.items;
+    size_t first = 0;
+    int signal = SIGTERM;
+    if (c->args.length > 1 && strcmp(args[0].str, "-s") == 0) {
+        signal = ParseSignal(args[1].str);
+        first = 2;
+    } else if (c->args.length > 0 && args[0].str[0] == '-') {
+        signal = ParseSignal(args[0].str + 1);
+        first = 1;
+    }
+    if (signal < 0 || first == c->args.length) {
+        printf("Usage: kill [-s signal | -signal] pid|%%job...\n");
+        return 1;
+    }
+    int status = 0;
+    for (size_t i = first; i < c->args.length; i++) {
+        long long id;
+        bool sent = false;
+        if (args[i].str[0] == '%' && ParseInteger(args[i].str + 1, &id)) {
+            size_t index = 0;
+            job* j;
+            while ((j = NextMap(&sh->jobs.jobs, &index)))
+                if (j->id == id && kill(j->pid, signal) == 0) sent = true;
+        } else if (ParseInteger(args[i].str, &id)) {
+            sent = kill(id, signal) == 0;
+        }
+        if (!sent) {
+            printf("Could not send signal %d to %s.\n", signal, args[i].str);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+/**
+ * Apply a utility's '<' and '>' to the shell's stdin and stdout.
+ * The shell's fds are kept in saved for RestoreIO which must always be called.
+ * Prints the same messages as PerformIO and returns true on failure.
+**/
+static bool RedirectIO(command* c, int saved[2]) {
+    bool badIO = false;
+    fflush(stdout);
+    TraceBegin(TRACE_REDIRECT, 0);
+    for (int i = 0; i < 2 && !badIO; i++) {
+        if (c->inOut[i].length == 0) continue;
+        int fd = open(c->inOut[i].str, i ? O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0760);
+        if (fd < 0) {
+            printf(i ? "Could not open file %s for output.\n" : "Could not open file %s for input.\n", c->inOut[i].str);
+            badIO = true;
+        } else {
+            saved[i] = fcntl(i, F_DUPFD_CLOEXEC, 10);
+            dup2(fd, i);
+            close(fd);
+        }
+    }
+    TraceEnd(TRACE_REDIRECT, badIO);
+    return badIO;
+}
+
+/**
+ * Put back the shell's stdin and stdout after RedirectIO.
+**/
+static void RestoreIO(int saved[2]) {
+    fflush(stdout);
+    for (int i = 0; i < 2; i++) {
+        if (saved[i] < 0) continue;
+        dup2(saved[i], i);
+        close(saved[i]);
+    }
+}
+
+// Builtins grouped by the length of their names for FindBuiltin.
+static const builtin length1[] = {{"[", CommandTest, BUILTIN_UTILITY}};
+static const builtin length2[] = {{"cd", CommandCD, 0}};
+static const builtin length3[] = {{"pwd", CommandPWD, BUILTIN_UTILITY}};
+static const builtin length4[] = {
+    {"echo", CommandEcho, BUILTIN_UTILITY},
+    {"exit", CommandExit, 0},
+    {"hash", CommandHash, 0},
+    {"jobs", CommandJobs, 0},
+    {"kill", CommandKill, BUILTIN_UTILITY | BUILTIN_FORK},
+    {"prio", CommandPrio, 0},
+    {"test", CommandTest, BUILTIN_UTILITY},
+    {"true", CommandTrue, BUILTIN_UTILITY}
+};
+static const builtin length5[] = {
+    {"false", CommandFalse, BUILTIN_UTILITY},
+    {"queue", CommandQueue, BUILTIN_FOREGROUND},
+    {"stats", CommandStats, 0},
+    {"trace", CommandTrace, 0},
+    {"unset", CommandUnset, 0}
+};
+static const builtin length6[] = {
+    {"export", CommandExport, 0},
+    {"output", CommandOutput, 0},
+    {"printf", CommandPrintf, BUILTIN_UTILITY},
+    {"status", CommandStatus, BUILTIN_KEEP_STATUS}
+};
+static const builtin length7[] = {{"history", CommandHistory, BUILTIN_UTILITY | BUILTIN_FORK}};
+static const builtin length8[] = {
+    {"affinity", CommandAffinity, 0},
+    {"parallel", CommandParallel, BUILTIN_FOREGROUND}
+};
+
+/**
+ * Find the builtin called name in a group of builtins with the same name length.
+**/
+static const builtin* MatchBuiltin(const builtin* group, size_t count, const char* name, size_t length) {
+    for (size_t i = 0; i < count; i++)
+        if (group[i].name[0] == name[0] && memcmp(group[i].name, name, length) == 0) return group + i;
+    return NULL;
+}
+
+#define MATCH_BUILTIN(group) MatchBuiltin(group, sizeof(group) / sizeof(*group), name, length)
+
+/**
+ * Find a builtin by name. The switch on the name's length leaves at most
+ *    a few names to compare so this costs about the same as one strcmp.
+ * @param name The command name.
+ * @param length The length of name.
+ * @return The builtin or NULL if the name is not a builtin.
+**/
+const builtin* FindBuiltin(const char* name, size_t length) {
+    switch (length) {
+        case 1: return MATCH_BUILTIN(length1);
+        case 2: return MATCH_BUILTIN(length2);
+        case 3: return MATCH_BUILTIN(length3);
+        case 4: return MATCH_BUILTIN(length4);
+        case 5: return MATCH_BUILTIN(length5);
+        case 6: return MATCH_BUILTIN(length6);
+        case 7: return MATCH_BUILTIN(length7);
+        case 8: return MATCH_BUILTIN(length8);
+        default: return NULL;
+    }
+}
+
+/**
+ * Check if a builtin can run in the shell process. In a pipeline or in the
+ *    background it needs a process of its own like any other command.
+**/
+bool CanRunBuiltin(shell* sh, command* c) {
+    return c->stages.length == 0 && !(c->background && !sh->foregroundOnly);
+}
+
+/**
+ * Check that no stage of a command that cannot run in the shell process is
+ *    a builtin with BUILTIN_FOREGROUND.
+ * @return false after printing which builtin if one is.
+**/
+bool CanForkBuiltins(shell* sh, command* c) {
+    if (CanRunBuiltin(sh, c)) return true;
+    for (size_t i = 0; i <= c->stages.length; i++) {
+        command* stage = i == 0 ? c : ((command*) c->stages.items) + i - 1;
+        const builtin* b = FindBuiltin(stage->commandName.str, stage->commandName.length);
+        if (b && (b->flags & BUILTIN_FOREGROUND)) {
+            printf("%s cannot run in a pipeline or in the background.\n", b->name);
+            fflush(stdout);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Check if a builtin in a pipeline or in the background runs in a fork of the
+ *    shell rather than launching the program it stands in for.
+**/
+bool ForksBuiltin(const builtin* b) {
+    return !(b->flags & BUILTIN_UTILITY) || (b->flags & BUILTIN_FORK);
+}
+
+/**
+ * Run a builtin in the shell process, redirecting utilities by
+ *    remapping the shell's fds while they run.
+**/
+void RunBuiltin(shell* sh, const builtin* b, command* c) {
+    int saved[2] = {-1, -1}, status = 1;
+    if (!(b->flags & BUILTIN_UTILITY) || !RedirectIO(c, saved)) status = b->Run(sh, c);
+    if (b->flags & BUILTIN_UTILITY) RestoreIO(saved);
+    else if (sh->interactive) fflush(stdout);
+    if (!(b->flags & BUILTIN_KEEP_STATUS)) SetStatus(sh, W_EXITCODE(status & 0xff, 0));
+}
@@ -0,0 +1,44 @@
+#ifndef builtins_h
+#define builtins_h
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "command.h"
+#include "shell.h"
+
+// In a pipeline or in the background a builtin runs in a fork of the shell
+//    so it cannot change the shell, the flags below aside.
+// A builtin version of a program. It runs with its '<' and '>' applied to the
+//    shell's own stdin and stdout and the program is launched instead when
+//    it is part of a pipeline or runs in the background.
+#define BUILTIN_UTILITY 1
+// A utility with no program of its own so it is forked like other builtins.
+#define BUILTIN_FORK 2
+// Leaves "$?" as it was so it can be looked at again.
+#define BUILTIN_KEEP_STATUS 4
+// Only works in the shell process so it is refused in a pipeline or in the background.
+#define BUILTIN_FOREGROUND 8
+
+/**=================================================================|
+ * A command run inside the shell process.                          |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * const char* name The command name that runs the builtin.         |
+ * int (*Run)(shell*, command*) Runs the builtin and returns its    |
+ *      exit code, which becomes "$?".                              |
+ * int flags BUILTIN_UTILITY, BUILTIN_FORK, BUILTIN_KEEP_STATUS and |
+ *      BUILTIN_FOREGROUND.                                         |
+ * =================================================================|
+**/
+typedef struct builtin {
+    const char* name;
+    int (*Run)(shell* sh, command* c);
+    int flags;
+} builtin;
+
+const builtin* FindBuiltin(const char* name, size_t length);
+bool CanRunBuiltin(shell* sh, command* c);
+bool CanForkBuiltins(shell* sh, command* c);
+bool ForksBuiltin(const builtin* b);
+void RunBuiltin(shell* sh, const builtin* b, command* c);
+#endif
\ No newline at end of file
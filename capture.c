@@ -0,0 +1,215 @@
+#include "capture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+// The most reads made from one pipe each time the captures are drained.
+#define CAPTURE_READS 16
+
+/**
+ * Hash a capture by its job id.
+**/
+static size_t HashCapture(const void* c) {
+    size_t id = ((const capture*) c)->id;
+    return HashBytes(&id, sizeof(id));
+}
+
+/**
+ * Compare two captures by their job ids.
+**/
+static bool EqualsCapture(const void* c1, const void* c2) {
+    return ((const capture*) c1)->id == ((const capture*) c2)->id;
+}
+
+/**
+ * Moves the second capture into the first capture.
+**/
+static void CopyConstructCapture(void* c1, void* c2) {
+    *(capture*) c1 = *(capture*) c2;
+    CopyConstructStr(&((capture*) c1)->commandLine, &((capture*) c2)->commandLine);
+}
+
+/**
+ * Close the capture's pipe and free its buffer.
+**/
+static void DestroyCapture(void* c) {
+    capture* cap = c;
+    if (cap->fd >= 0) close(cap->fd);
+    free(cap->buffer);
+    DestroyStr(&cap->commandLine);
+}
+
+/**
+ * Creates an empty capture table which does not capture jobs until capture_table::size is set.
+**/
+void ConstructCaptureTable(capture_table* table) {
+    table->captures = ConstructMap(sizeof(capture), HashCapture, EqualsCapture, CopyConstructCapture, DestroyCapture);
+    table->epollFD = epoll_create1(EPOLL_CLOEXEC);
+    table->size = 0;
+    table->open = 0;
+}
+
+/**
+ * Start capturing a job's output.
+ * @param table The table to add the capture to.
+ * @param id The job id.
+ * @param pid The pid of the job's last process.
+ * @param fd The read end of the pipe the job writes to, it belongs to the table even on failure.
+ * @param commandLine The line the job was started from.
+ * @return If the capture was added.
+**/
+bool AddCapture(capture_table* table, size_t id, pid_t pid, int fd, string* commandLine) {
+    capture c = {id, pid, {0}, fd, malloc(table->size), table->size, 0, 0, 0};
+    struct epoll_event event = {EPOLLIN, {.u64 = id}};
+    if (c.buffer == NULL || fcntl(fd, F_SETFL, O_NONBLOCK) < 0 || epoll_ctl(table->epollFD, EPOLL_CTL_ADD, fd, &event) < 0) {
+        free(c.buffer);
+        close(fd);
+        return false;
+    }
+    ConstructStr(&c.commandLine, commandLine->str);
+    PutMap(&table->captures, &c);
+    table->open++;
+    return true;
+}
+
+/**
+ * Add bytes to the end of a capture's ring buffer, dropping its oldest bytes if it is full.
+**/
+static void Append(capture* c, const char* bytes, size_t count) {
+    c->total += count;
+    // Only the newest size bytes can be kept.
+    if (count > c->size) {
+        bytes += count - c->size;
+        count = c->size;
+    }
+    size_t end = (c->start + c->length) % c->size;
+    size_t first = count < c->size - end ? count : c->size - end;
+    memcpy(c->buffer + end, bytes, first);
+    memcpy(c->buffer, bytes + first, count - first);
+    c->length += count;
+    if (c->length > c->size) {
+        c->start = (c->start + c->length - c->size) % c->size;
+        c->length = c->size;
+    }
+}
+
+/**
+ * Read what a job has written without blocking. The reads are bounded so a job
+ *    writing faster than the shell reads cannot keep the shell here.
+ * @return true if the pipe reached end of file and was closed.
+**/
+static bool DrainCapture(capture_table* table, capture* c) {
+    char chunk[16384];
+    for (int reads = 0; reads < CAPTURE_READS; reads++) {
+        ssize_t bytes = read(c->fd, chunk, sizeof(chunk));
+        if (bytes > 0) {
+            Append(c, chunk, bytes);
+            continue;
+        }
+        if (bytes < 0 && (errno == EAGAIN || errno == EINTR)) break;
+        // Every process of the job has exited, closing also removes it from the epoll instance.
+        close(c->fd);
+        c->fd = -1;
+        table->open--;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Forget the captures of the oldest finished jobs until at most CAPTURE_KEEP are left.
+**/
+static void ForgetOldCaptures(capture_table* table) {
+    while (table->captures.length - table->open > CAPTURE_KEEP) {
+        size_t index = 0;
+        capture* c, *oldest = NULL;
+        while ((c = NextMap(&table->captures, &index)))
+            if (c->fd < 0 && (oldest == NULL || c->id < oldest->id)) oldest = c;
+        capture probe = {oldest->id};
+        RemoveMap(&table->captures, &probe);
+    }
+}
+
+/**
+ * Read every pipe with output waiting without blocking.
+ * @return The number of pipes read.
+**/
+size_t DrainCaptures(capture_table* table) {
+    if (table->open == 0) return 0;
+    struct epoll_event events[16];
+    int count = epoll_wait(table->epollFD, events, 16, 0);
+    bool closed = false;
+    for (int i = 0; i < count; i++) {
+        capture probe = {events[i].data.u64};
+        capture* c = GetMap(&table->captures, &probe);
+        if (c != NULL && c->fd >= 0) closed |= DrainCapture(table, c);
+    }
+    if (closed) ForgetOldCaptures(table);
+    return count > 0 ? count : 0;
+}
+
+/**
+ * Find a capture by job id or, failing that, by the pid printed when the job started.
+**/
+static capture* FindCapture(capture_table* table, size_t number) {
+    capture probe = {number};
+    capture* c = GetMap(&table->captures, &probe);
+    size_t index = 0;
+    while (c == NULL && (c = NextMap(&table->captures, &index)))
+        if (c->pid != (pid_t) number) c = NULL;
+    return c;
+}
+
+/**
+ * Print what a job has written, or only its last lines.
+ * @param table The captures.
+ * @param number The job id or the pid printed when the job started.
+ * @param lines The number of lines to print from the end, 0 for everything kept.
+ * @return false if there is no capture for number.
+**/
+bool PrintCapture(capture_table* table, size_t number, size_t lines) {
+    DrainCaptures(table);
+    capture* c = FindCapture(table, number);
+    if (c == NULL) return false;
+    // Walk back from the newest byte, the newline ending the last line is not counted.
+    size_t skip = 0, newlines = 0;
+    for (size_t i = c->length; lines > 0 && i > 1; i--) {
+        if (c->buffer[(c->start + i - 2) % c->size] == '\n' && ++newlines == lines) {
+            skip = i - 1;
+            break;
+        }
+    }
+    if (skip == 0 && c->total > c->length) printf("(%zu earlier bytes were dropped)\n", c->total - c->length);
+    size_t from = (c->start + skip) % c->size, count = c->length - skip;
+    size_t first = count < c->size - from ? count : c->size - from;
+    fwrite(c->buffer + from, 1, first, stdout);
+    fwrite(c->buffer, 1, count - first, stdout);
+    fflush(stdout);
+    return true;
+}
+
+/**
+ * Print every capture, if its job is still writing and how much of its output is kept.
+**/
+void PrintCaptures(capture_table* table) {
+    DrainCaptures(table);
+    size_t index = 0;
+    capture* c;
+    while ((c = NextMap(&table->captures, &index))) {
+        printf("[%zu] %d %s, %zu of %zu bytes kept: %s\n", c->id, c->pid, c->fd >= 0 ? "writing" : "finished",
+            c->length, c->total, c->commandLine.str);
+    }
+    fflush(stdout);
+}
+
+/**
+ * Cleans up the capture table, closing every pipe.
+**/
+void DestroyCaptureTable(capture_table* table) {
+    DestroyMap(&table->captures);
+    close(table->epollFD);
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef capture_h
+#define capture_h
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include "map/map.h"
+#include "string/str.h"
+
+// The number of captures of finished jobs kept for the output builtin.
+#define CAPTURE_KEEP 16
+
+/**=================================================================|
+ * The captured stdout and stderr of one background job.            |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * Output is kept in a ring buffer of a fixed size so only the      |
+ * newest bytes are kept once the job has written more than fits.   |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * size_t id The job id, the key of the capture table.              |
+ * pid_t pid The pid of the job's last process, the one printed     |
+ *      when it started.                                            |
+ * string commandLine The line the job was started from.            |
+ * int fd The read end of the job's pipe or -1 once every process   |
+ *      of the job has closed it.                                   |
+ * char* buffer The ring buffer.                                    |
+ * size_t size The size of buffer.                                  |
+ * size_t start Where the oldest byte kept is in buffer.            |
+ * size_t length The number of bytes kept.                          |
+ * size_t total The number of bytes the job has written, the bytes  |
+ *      past length were dropped.                                   |
+ * =================================================================|
+**/
+typedef struct capture {
+    size_t id;
+    pid_t pid;
+    string commandLine;
+    int fd;
+    char* buffer;
+    size_t size, start, length, total;
+} capture;
+
+/**=================================================================|
+ * The output captures of background jobs keyed by job id.          |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * The read end of every pipe is non-blocking and watched by its    |
+ * own epoll instance so the shell can wait on all of them with a   |
+ * single fd and drain them without ever blocking on a job.         |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * map captures The capture structs keyed by capture::id.           |
+ * int epollFD Watches the read end of every open capture.          |
+ * size_t size The ring buffer size of new captures, 0 to not       |
+ *      capture background jobs.                                    |
+ * size_t open The number of captures with an open pipe.            |
+ * =================================================================|
+**/
+typedef struct capture_table {
+    map captures;
+    int epollFD;
+    size_t size;
+    size_t open;
+} capture_table;
+
+void ConstructCaptureTable(capture_table* table);
+bool AddCapture(capture_table* table, size_t id, pid_t pid, int fd, string* commandLine);
+size_t DrainCaptures(capture_table* table);
+bool PrintCapture(capture_table* table, size_t number, size_t lines);
+void PrintCaptures(capture_table* table);
+void DestroyCaptureTable(capture_table* table);
+#endif
\ No newline at end of file
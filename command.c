@@ -1,90 +1,287 @@
 #include "command.h"
+#include "tokenizer.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 /**
- * Initialize the command struct by parsing the commandStr.
+ * Initialize an empty command with no stages.
+**/
+static void ConstructStage(command* c, memory_manager* manager) {
+    ConstructManagedStr(&c->commandName, "", manager);
+    c->args = ConstructManagedVector(sizeof(string), CopyConstructStr, (void (*)(void*)) DestroyStr, manager);
+    ConstructManagedStr(&c->inOut[0], "", manager);
+    ConstructManagedStr(&c->inOut[1], "", manager);
+    c->background = false;
+    // Stages are only allocated once the first '|' is seen.
+    c->stages = (vector) {0, 0, sizeof(command), NULL, CopyConstructCommand, (void (*)(void*)) DestroyCommand, manager};
+    c->execArgs = NULL;
+    // The same goes for the list once the first ';', "&&" or "||" is seen.
+    c->join = JOIN_ALWAYS;
+    c->sequence = c->stages;
+}
+
+/**
+ * Initialize an empty command to be filled in directly instead of parsed.
+ * Every string and vector of the command allocates from manager.
 **/
-command* ConstructCommand(command* c, size_t length, char* const commandStr) {
+command* ConstructEmptyCommand(command* c, memory_manager* manager) {
     if (c == NULL) c = malloc(sizeof(command));
-    char* token;
-    char* savePtr = NULL;
-    // The first strtok_r result will be the commandName/filename.
-    token = strtok_r(commandStr, " \n", &savePtr);
-    ConstructStr(&c->commandName, token);
-    c->args = ConstructVector(sizeof(string), CopyConstructStr, (void (*)(void*)) DestroyStr);
-    // If the last three characters in commandStr are " &\n" the command wants to run in the background.
-    c->background = strcmp(commandStr + length - 3, " &\n") == 0;
+    ConstructStage(c, manager);
+    return c;
+}
+
+/**
+ * Fill in an empty command from the tokens of one command of a list.
+ * The redirections are kept on the head so '<' may only come in the first
+ *    stage of a pipeline and '>' only in the last.
+ * @return false after printing why if a stage has no command or a
+ *    redirection is in the wrong stage.
+**/
+static bool ParseTokens(command* c, token* t, size_t count, char* const commandStr, memory_manager* manager) {
+    // A trailing '&' means the command wants to run in the background.
+    c->background = count > 0 && t[count - 1].type == TOKEN_BACKGROUND;
+    if (c->background) count--;
+    // Nothing but a '&' is an empty command like a blank line.
+    if (count == 0) {
+        c->background = false;
+        return true;
+    }
     // If we are in the background default redirection to /dev/null.
-    ConstructStr(&c->inOut[0], c->background ? "/dev/null" : "");
-    ConstructStr(&c->inOut[1], c->background ? "/dev/null" : "");
-    // If we are in the background remove the last 3 characters from the commandStr.
-    if (c->background) commandStr[length-2] = 0;
-    while ((token = strtok_r(NULL, " \n", &savePtr))) {
-        switch (token[0]) {
-            case '<': // Input redirection change command::inOut[0].
-                SetCStr(&c->inOut[0], (const char*) strtok_r(NULL, " \n", &savePtr));
+    if (c->background) {
+        SetCStr(&c->inOut[0], "/dev/null");
+        SetCStr(&c->inOut[1], "/dev/null");
+    }
+
+    command* stage = c;
+    bool named = false, redirected = false;
+    for (size_t i = 0; i < count; i++) {
+        switch (t[i].type) {
+            case TOKEN_INPUT: // Input redirection change command::inOut[0].
+            case TOKEN_OUTPUT: // Output redirection change command::inOut[1].
+                if (t[i].type == TOKEN_INPUT && stage != c) {
+                    printf("Only the first command of a pipeline can redirect its input.\n");
+                    return false;
+                }
+                redirected |= t[i].type == TOKEN_OUTPUT;
+                if (i + 1 < count && t[i + 1].type == TOKEN_WORD) {
+                    string* file = &c->inOut[t[i].type == TOKEN_OUTPUT];
+                    DestroyStr(file);
+                    ConstructStrView(file, commandStr + t[i + 1].offset, t[i + 1].length, manager);
+                    i++;
+                }
                 break;
-            case '>': // Output redirection change command::inOut[1].
-                SetCStr(&c->inOut[1], (const char*) strtok_r(NULL, " \n", &savePtr));
+            case TOKEN_PIPE: // Pipe into a new stage whose first word is its commandName.
+                {
+                    if (!named) {
+                        printf("A command of the pipeline is missing.\n");
+                        return false;
+                    } else if (redirected) {
+                        printf("Only the last command of a pipeline can redirect its output.\n");
+                        return false;
+                    }
+                    if (c->stages.size == 0)
+                        c->stages = ConstructManagedVector(sizeof(command), CopyConstructCommand, (void (*)(void*)) DestroyCommand, manager);
+                    command s;
+                    ConstructStage(&s, manager);
+                    s.background = c->background;
+                    PushBackVector(&c->stages, &s);
+                    stage = ((command*) c->stages.items) + c->stages.length - 1;
+                    named = false;
+                }
                 break;
             default:
                 {
-                    // Push the arg into the command::args vector.
+                    // A '&' before the end of the command is just an argument.
                     string s;
-                    ConstructStr(&s, token);
-                    if (s.length > 0) PushBackVector(&c->args, &s);
+                    if (t[i].type == TOKEN_WORD) ConstructStrView(&s, commandStr + t[i].offset, t[i].length, manager);
+                    else ConstructManagedStr(&s, "&", manager);
+                    // The first word of a stage is its commandName, the rest go into command::args.
+                    if (!named) {
+                        stage->commandName = s;
+                        CopyConstructStr(&stage->commandName, &stage->commandName);
+                        named = true;
+                    } else {
+                        PushBackVector(&stage->args, &s);
+                    }
                 }
                 break;
         }
     }
+    if (!named && stage != c) {
+        printf("A command of the pipeline is missing.\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Initialize the command struct by parsing the commandStr.
+ * A line with ';', "&&" or "||" is parsed into its first command with the
+ *    rest in command::sequence. Empty commands of a list are skipped.
+ * A line with a syntax error is parsed into an empty command which runs nothing.
+ * Words are not copied, the command's strings are views of commandStr
+ *    which is null-terminated after every word so commandStr must outlive
+ *    the command. A view is only copied when expansion changes it.
+ * Every string and vector of the command allocates from manager,
+ *    which may be NULL to use malloc.
+**/
+command* ConstructCommand(command* c, size_t length, char* const commandStr, memory_manager* manager) {
+    if (c == NULL) c = malloc(sizeof(command));
+    ConstructStage(c, manager);
+    vector tokens = ConstructManagedVector(sizeof(token), NULL, NULL, manager);
+    size_t count = Tokenize(&tokens, commandStr, length);
+    token* t = tokens.items;
+    for (size_t i = 0; i < count; i++)
+        if (t[i].type == TOKEN_WORD) commandStr[t[i].offset + t[i].length] = 0;
+
+    command_join join = JOIN_ALWAYS;
+    bool parsed = false, valid = true;
+    for (size_t start = 0, end = 0; valid && start < count; start = ++end) {
+        while (end < count && t[end].type != TOKEN_SEQUENCE && t[end].type != TOKEN_AND && t[end].type != TOKEN_OR) end++;
+        if (end > start) {
+            if (!parsed) {
+                valid = ParseTokens(c, t + start, end - start, commandStr, manager);
+                parsed = true;
+            } else {
+                if (c->sequence.size == 0)
+                    c->sequence = ConstructManagedVector(sizeof(command), CopyConstructCommand, (void (*)(void*)) DestroyCommand, manager);
+                command next;
+                ConstructStage(&next, manager);
+                valid = ParseTokens(&next, t + start, end - start, commandStr, manager);
+                next.join = join;
+                PushBackVector(&c->sequence, &next);
+            }
+        }
+        if (end < count) join = t[end].type == TOKEN_AND ? JOIN_AND : t[end].type == TOKEN_OR ? JOIN_OR : JOIN_ALWAYS;
+    }
+    DestroyVector(&tokens);
+    // Nothing of a line with a syntax error runs.
+    if (!valid) {
+        DestroyCommand(c);
+        ConstructStage(c, manager);
+    }
     return c;
 }
 
 /**
- * Replace "$$" with the pidStr.
+ * Moves the second command into the first command.
+ * Used as the command::stages copy constructor so the inline
+ *    strings keep pointing into their own struct.
+**/
+void CopyConstructCommand(void* v1, void* v2) {
+    command* c1 = v1;
+    command* c2 = v2;
+    *c1 = *c2;
+    CopyConstructStr(&c1->commandName, &c1->commandName);
+    CopyConstructStr(&c1->inOut[0], &c1->inOut[0]);
+    CopyConstructStr(&c1->inOut[1], &c1->inOut[1]);
+    if (c1->execArgs) c1->execArgs[0] = c1->commandName.str;
+}
+
+/**
+ * Copy every string of src into dest allocating from manager.
+ * Unlike CopyConstructCommand dest does not share anything with src so
+ *    a command parsed into an arena can outlive it. command::execArgs is not copied.
+**/
+command* DeepCopyCommand(command* dest, command* src, memory_manager* manager) {
+    if (dest == NULL) dest = malloc(sizeof(command));
+    ConstructStage(dest, manager);
+    SetCStr(&dest->commandName, src->commandName.str);
+    SetCStr(&dest->inOut[0], src->inOut[0].str);
+    SetCStr(&dest->inOut[1], src->inOut[1].str);
+    dest->background = src->background;
+    dest->join = src->join;
+    for (size_t i = 0; i < src->args.length; i++) {
+        string arg;
+        ConstructManagedStr(&arg, ((string*) src->args.items)[i].str, manager);
+        PushBackVector(&dest->args, &arg);
+    }
+    if (src->stages.length > 0)
+        dest->stages = ConstructManagedVector(sizeof(command), CopyConstructCommand, (void (*)(void*)) DestroyCommand, manager);
+    for (size_t i = 0; i < src->stages.length; i++) {
+        command stage;
+        DeepCopyCommand(&stage, ((command*) src->stages.items) + i, manager);
+        PushBackVector(&dest->stages, &stage);
+    }
+    if (src->sequence.length > 0)
+        dest->sequence = ConstructManagedVector(sizeof(command), CopyConstructCommand, (void (*)(void*)) DestroyCommand, manager);
+    for (size_t i = 0; i < src->sequence.length; i++) {
+        command next;
+        DeepCopyCommand(&next, ((command*) src->sequence.items) + i, manager);
+        PushBackVector(&dest->sequence, &next);
+    }
+    return dest;
+}
+
+/**
+ * Drop the words that expanded to nothing. If the command name is one of
+ *    them the first arg left becomes the command name.
 **/
-void PidReplace(string* s, char* pidStr) {
-    size_t pidLength = strlen(pidStr);
-    for (int i = 0; i < s->length; i++) {
-        if (GetStrChar(s, i) == '$' && GetStrChar(s, i + 1) == '$') {
-            // Create a temp copy of the right substring.
-            string temp;
-            ConstructStr(&temp, "");
-            SubString(&temp, s, i + 2, s->length);
-            // Reduce the length of s to i.
-            s->length = i;
-            // Append the pid and the right substring.
-            AppendCStr(s, pidStr);
-            AppendString(s, &temp);
-            DestroyStr(&temp);
-            i += pidLength;
+static void DropEmptyWords(command* c) {
+    string* args = c->args.items;
+    size_t kept = 0, i = 0;
+    if (c->commandName.length == 0) {
+        while (i < c->args.length && args[i].length == 0) DestroyStr(args + i++);
+        if (i < c->args.length) {
+            DestroyStr(&c->commandName);
+            c->commandName = args[i++];
+            CopyConstructStr(&c->commandName, &c->commandName);
         }
     }
+    for (; i < c->args.length; i++) {
+        if (args[i].length == 0) {
+            DestroyStr(args + i);
+            continue;
+        }
+        if (kept != i) {
+            args[kept] = args[i];
+            CopyConstructStr(args + kept, args + kept);
+        }
+        kept++;
+    }
+    c->args.length = kept;
 }
 
 /**
- * Replace "$$" in all command strings(commandName, args..., inOut[0], inOut[1]).
+ * Expand the variables in all command strings(commandName, args..., inOut[0], inOut[1], stages...).
+ * Each string is expanded once in a single pass by ExpandString and the
+ *    words that expand to nothing are dropped.
+ * Then args with wildcards are replaced by the paths they match in dirs,
+ *    unless dirs is NULL.
+ * The commands of command::sequence are not expanded, each one is
+ *    expanded right before it runs to see what the commands before it set.
 **/
-void PostProcessCommand(command* c, pid_t pid) {
-    char pidStr[12];
-    sprintf(pidStr, "%d", pid);
-    PidReplace(&c->commandName, pidStr);
+void PostProcessCommand(command* c, variable_store* vars, dir_cache* dirs) {
+    ExpandString(&c->commandName, vars);
     for (int i = 0; i < c->args.length; i++) {
-        PidReplace(&((string*) c->args.items)[i], pidStr);
+        ExpandString(&((string*) c->args.items)[i], vars);
+    }
+    DropEmptyWords(c);
+    if (dirs) ExpandWildcards(dirs, &c->args);
+    ExpandString(&c->inOut[0], vars);
+    ExpandString(&c->inOut[1], vars);
+    for (int i = 0; i < c->stages.length; i++) {
+        command* stage = ((command*) c->stages.items) + i;
+        ExpandString(&stage->commandName, vars);
+        for (int j = 0; j < stage->args.length; j++) {
+            ExpandString(&((string*) stage->args.items)[j], vars);
+        }
+        DropEmptyWords(stage);
+        if (dirs) ExpandWildcards(dirs, &stage->args);
     }
-    PidReplace(&c->inOut[0], pidStr);
-    PidReplace(&c->inOut[1], pidStr);
 }
 
 /**
  * Destroy all command members.
 **/
 void DestroyCommand(command* command) {
+    if (command->execArgs) Free(command->args.manager, command->execArgs);
     DestroyStr(&command->commandName);
     DestroyVector(&command->args);
     DestroyStr(&command->inOut[0]);
     DestroyStr(&command->inOut[1]);
+    DestroyVector(&command->stages);
+    DestroyVector(&command->sequence);
 }
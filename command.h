@@ -1,16 +1,41 @@
+#ifndef command_h
+#define command_h
 #include <stdbool.h>
+#include <sys/types.h>
 
 #include "string/str.h"
+#include "vars.h"
 #include "vector/vector.h"
+#include "wildcard.h"
+
+/**
+ * How a command of a list is joined to the command before it.
+ * JOIN_ALWAYS After ';' or the first command, it always runs.
+ * JOIN_AND After "&&", it runs if the last command run succeeded.
+ * JOIN_OR After "||", it runs if the last command run failed.
+**/
+typedef enum command_join {
+    JOIN_ALWAYS,
+    JOIN_AND,
+    JOIN_OR
+} command_join;
 
 typedef struct command {
     string commandName;
     vector args;
     string inOut[2];
     bool background;
+    vector stages; // Pipeline stages after this one, each reads the previous stage's output.
+    char** execArgs; // A prebuilt argv for exec owned by the command or NULL to build one per launch.
+    command_join join; // How this command is joined to the one before it in a list.
+    vector sequence; // Commands after this one in a ';', "&&" and "||" list, run one after another.
 } command;
 
-command* ConstructCommand(command* c, size_t length, char* const command);
-void PostProcessCommand(command* c, pid_t pid);
+command* ConstructEmptyCommand(command* c, memory_manager* manager);
+command* ConstructCommand(command* c, size_t length, char* const command, memory_manager* manager);
+void CopyConstructCommand(void* c1, void* c2);
+command* DeepCopyCommand(command* dest, command* src, memory_manager* manager);
+void PostProcessCommand(command* c, variable_store* vars, dir_cache* dirs);
 void PrintCommand(command* command);
-void DestroyCommand(command* command);
\ No newline at end of file
+void DestroyCommand(command* command);
+#endif
\ No newline at end of file
@@ -0,0 +1,333 @@
+#include "history.h"
+#include "map/map.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#define HISTORY_MAGIC "SMSHHIS2"
+// The number of table slots of a new history.
+#define HISTORY_SLOTS 1024
+
+/**
+ * Get the records that follow the header of the index file.
+**/
+static history_record* Records(history* h) {
+    return (history_record*) (h->header + 1);
+}
+
+/**
+ * Replace a mapping of a file with one of size bytes.
+ * @return The new mapping or NULL if size is 0 or the file could not be mapped.
+**/
+static void* Remap(void* old, size_t oldSize, int fd, size_t size, int prot) {
+    if (old) munmap(old, oldSize);
+    if (size == 0) return NULL;
+    void* mapping = mmap(NULL, size, prot, MAP_SHARED, fd, 0);
+    return mapping == MAP_FAILED ? NULL : mapping;
+}
+
+/**
+ * Map the files again if this or another shell has changed their sizes.
+ * Must be called with the index file locked.
+ * @return false if a file could not be mapped.
+**/
+static bool Refresh(history* h) {
+    struct stat info;
+    if (fstat(h->indexFD, &info) < 0 || info.st_size < sizeof(history_header)) return false;
+    if (info.st_size != h->indexSize || h->header == NULL) {
+        h->header = Remap(h->header, h->indexSize, h->indexFD, info.st_size, PROT_READ | PROT_WRITE);
+        h->indexSize = h->header ? info.st_size : 0;
+        if (h->header == NULL) return false;
+    }
+    size_t tableSize = h->header->slots * sizeof(history_slot);
+    if (tableSize != h->tableSize || h->table == NULL) {
+        h->table = Remap(h->table, h->tableSize, h->tableFD, tableSize, PROT_READ | PROT_WRITE);
+        h->tableSize = h->table ? tableSize : 0;
+        if (h->table == NULL) return false;
+    }
+    if (fstat(h->dataFD, &info) < 0) return false;
+    // The history file is mapped with room to grow so appends rarely remap it.
+    if (info.st_size > h->dataMapped) {
+        h->data = Remap((void*) h->data, h->dataMapped, h->dataFD, info.st_size * 2, PROT_READ);
+        h->dataMapped = h->data ? info.st_size * 2 : 0;
+    }
+    h->dataSize = h->data ? info.st_size : 0;
+    return true;
+}
+
+/**
+ * Find the slot of a prefix hash, or the empty slot it would go in.
+**/
+static history_slot* FindSlot(history* h, uint64_t hash) {
+    size_t mask = h->header->slots - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        if (h->table[i].entry == 0 || h->table[i].hash == hash) return h->table + i;
+    }
+}
+
+/**
+ * Make entry n the newest entry of each of its prefixes up to HISTORY_PREFIX
+ *    characters, linking it to the previous entry with its longest one.
+**/
+static void IndexEntry(history* h, uint64_t n) {
+    history_record* r = Records(h) + n - 1;
+    const char* line = h->data + r->offset;
+    r->previous = 0;
+    // The FNV-1a of HashBytes one character at a time so each prefix's hash extends the last.
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t length = 1; length <= r->length && length <= HISTORY_PREFIX; length++) {
+        hash = (hash ^ (uint8_t) line[length - 1]) * 1099511628211ULL;
+        history_slot* slot = FindSlot(h, hash);
+        if (slot->entry == 0) {
+            slot->hash = hash;
+            h->header->used++;
+        }
+        if (length == HISTORY_PREFIX) r->previous = slot->entry;
+        slot->entry = n;
+    }
+}
+
+/**
+ * Empty the table file, resize it to slots and index every entry again.
+**/
+static bool ResizeTable(history* h, uint64_t slots) {
+    if (ftruncate(h->tableFD, 0) < 0 || ftruncate(h->tableFD, slots * sizeof(history_slot)) < 0) return false;
+    h->header->slots = slots;
+    h->header->used = 0;
+    if (!Refresh(h)) return false;
+    for (uint64_t n = 1; n <= h->header->count; n++)
+        IndexEntry(h, n);
+    return true;
+}
+
+/**
+ * Add the line at offset of the history file as the next entry.
+ * Must be called with the index file locked exclusively.
+**/
+static bool AppendEntry(history* h, uint64_t offset, uint32_t length) {
+    size_t needed = sizeof(history_header) + (h->header->count + 1) * sizeof(history_record);
+    if (needed > h->indexSize && (ftruncate(h->indexFD, needed * 2) < 0 || !Refresh(h))) return false;
+    // Keep the table at most half full.
+    if ((h->header->used + HISTORY_PREFIX) * 2 > h->header->slots && !ResizeTable(h, h->header->slots * 2)) return false;
+    history_record* r = Records(h) + h->header->count;
+    r->offset = offset;
+    r->length = length;
+    IndexEntry(h, h->header->count + 1);
+    h->header->count++;
+    h->header->dataEnd = offset + length + 1;
+    return true;
+}
+
+/**
+ * Index the lines at the end of the history file that have no entry yet,
+ *    which are left by a shell that stopped between its two appends.
+**/
+static bool IndexTail(history* h) {
+    const char* newline;
+    while (h->header->dataEnd < h->dataSize && (newline = memchr(h->data + h->header->dataEnd, '\n', h->dataSize - h->header->dataEnd))) {
+        uint64_t offset = h->header->dataEnd;
+        if (newline == h->data + offset) h->header->dataEnd++;
+        else if (!AppendEntry(h, offset, newline - h->data - offset)) return false;
+    }
+    return true;
+}
+
+/**
+ * Open or create the history at path with its index at path.idx and
+ *    table at path.tab. An index that does not match the history is rebuilt.
+ * @param h The history to open.
+ * @param path The history file, NULL or empty for no history.
+ * @return false if the history could not be opened, h is then empty and
+ *    every other function does nothing.
+**/
+bool OpenHistory(history* h, const char* path) {
+    *h = (history) {-1, -1, -1, NULL, NULL, NULL, 0, 0, 0, 0};
+    if (path == NULL || path[0] == 0) return false;
+    char indexPath[PATH_MAX], tablePath[PATH_MAX];
+    if (snprintf(indexPath, sizeof(indexPath), "%s.idx", path) >= sizeof(indexPath)) return false;
+    snprintf(tablePath, sizeof(tablePath), "%s.tab", path);
+    h->dataFD = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    h->indexFD = open(indexPath, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    h->tableFD = open(tablePath, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (h->dataFD < 0 || h->indexFD < 0 || h->tableFD < 0) {
+        CloseHistory(h);
+        return false;
+    }
+    flock(h->indexFD, LOCK_EX);
+    history_header header;
+    struct stat info;
+    bool valid = pread(h->indexFD, &header, sizeof(header), 0) == sizeof(header) && memcmp(header.magic, HISTORY_MAGIC, 8) == 0
+        && fstat(h->dataFD, &info) == 0 && header.dataEnd <= info.st_size;
+    if (!valid) {
+        // Start over, this is the only time the whole history file is read.
+        header = (history_header) {HISTORY_MAGIC, 0, 0, HISTORY_SLOTS, 0};
+        valid = ftruncate(h->indexFD, 0) == 0 && ftruncate(h->indexFD, sizeof(header) + HISTORY_SLOTS * sizeof(history_record)) == 0
+            && pwrite(h->indexFD, &header, sizeof(header), 0) == sizeof(header)
+            && ftruncate(h->tableFD, 0) == 0 && ftruncate(h->tableFD, HISTORY_SLOTS * sizeof(history_slot)) == 0;
+    }
+    valid = valid && Refresh(h) && IndexTail(h);
+    flock(h->indexFD, LOCK_UN);
+    if (!valid) CloseHistory(h);
+    return valid;
+}
+
+/**
+ * Append a line to the history. A trailing newline is not stored.
+ * The line is written with one append so shells sharing the history
+ *    never interleave lines.
+ * @return false if the line is empty or could not be added.
+**/
+bool AddHistory(history* h, const char* line, size_t length) {
+    if (length > 0 && line[length - 1] == '\n') length--;
+    if (h->dataFD < 0 || length == 0 || memchr(line, '\n', length)) return false;
+    flock(h->indexFD, LOCK_EX);
+    bool added = Refresh(h) && IndexTail(h);
+    uint64_t offset = h->dataSize;
+    struct iovec parts[2] = {{(void*) line, length}, {"\n", 1}};
+    added = added && writev(h->dataFD, parts, 2) == length + 1 && Refresh(h) && AppendEntry(h, offset, length);
+    flock(h->indexFD, LOCK_UN);
+    return added;
+}
+
+/**
+ * Get the number of entries, which is also the number of the newest entry.
+**/
+size_t HistoryLength(history* h) {
+    return h->header ? h->header->count : 0;
+}
+
+/**
+ * Append entry n to line.
+ * @param h The history.
+ * @param n The entry number, from 1.
+ * @param line The string the entry is appended to.
+ * @return The length of the entry or 0 if there is no entry n.
+**/
+size_t GetHistory(history* h, size_t n, string* line) {
+    if (h->dataFD < 0) return 0;
+    size_t length = 0;
+    flock(h->indexFD, LOCK_SH);
+    if (Refresh(h) && n > 0 && n <= h->header->count) {
+        history_record* r = Records(h) + n - 1;
+        length = r->length;
+        AppendCStrN(line, h->data + r->offset, length);
+    }
+    flock(h->indexFD, LOCK_UN);
+    return length;
+}
+
+/**
+ * Check if entry n starts with prefix.
+**/
+static bool StartsWith(history* h, size_t n, const char* prefix, size_t length) {
+    history_record* r = Records(h) + n - 1;
+    return r->length >= length && memcmp(h->data + r->offset, prefix, length) == 0;
+}
+
+/**
+ * Find the newest entry starting with prefix.
+ * A prefix of up to HISTORY_PREFIX characters is looked up in the table.
+ *    A longer one walks the entries sharing its first HISTORY_PREFIX characters.
+ * @return The entry number or 0 if no entry starts with prefix.
+**/
+size_t FindHistory(history* h, const char* prefix, size_t length) {
+    if (h->dataFD < 0) return 0;
+    size_t found = 0, indexed = length < HISTORY_PREFIX ? length : HISTORY_PREFIX;
+    flock(h->indexFD, LOCK_SH);
+    if (Refresh(h)) {
+        found = length == 0 ? h->header->count : FindSlot(h, HashBytes(prefix, indexed))->entry;
+        if (found > 0 && !StartsWith(h, found, prefix, indexed)) {
+            // Another prefix with the same hash has the slot so every entry is searched.
+            found = h->header->count;
+            while (found > 0 && !StartsWith(h, found, prefix, length)) found--;
+        }
+        while (found > 0 && !StartsWith(h, found, prefix, length)) found = Records(h)[found - 1].previous;
+    }
+    flock(h->indexFD, LOCK_UN);
+    return found;
+}
+
+/**
+ * If length characters of s are all digits.
+**/
+static bool IsNumber(const char* s, size_t length) {
+    for (size_t i = 0; i < length; i++)
+        if (!isdigit(s[i])) return false;
+    return length > 0;
+}
+
+/**
+ * Replace a history reference at the start of line with the entry it names:
+ *    !! the newest entry, !n entry n, !-n the nth newest entry and
+ *    !prefix the newest entry starting with prefix.
+ * The rest of the line is kept after the entry and the new line is printed.
+ * @param h The history.
+ * @param s The line, it is changed in place.
+ * @return false if the reference did not match an entry.
+**/
+bool ExpandHistory(history* h, string* s) {
+    char* line = s->str;
+    size_t length = s->length;
+    if (length < 2 || line[0] != '!' || isspace(line[1])) return true;
+    size_t end = 1;
+    while (end < length && !isspace(line[end])) end++;
+    const char* reference = line + 1;
+    size_t referenceLength = end - 1, count = HistoryLength(h), n;
+    if (referenceLength == 1 && reference[0] == '!') n = count;
+    else if (IsNumber(reference, referenceLength)) n = strtoul(reference, NULL, 10);
+    else if (reference[0] == '-' && IsNumber(reference + 1, referenceLength - 1)) n = count + 1 - strtoul(reference + 1, NULL, 10);
+    else n = FindHistory(h, reference, referenceLength);
+
+    string entry;
+    ConstructStr(&entry, "");
+    if (n == 0 || n > count || GetHistory(h, n, &entry) == 0) {
+        printf("No history entry matches %.*s.\n", (int) end, line);
+        fflush(stdout);
+        DestroyStr(&entry);
+        return false;
+    }
+    AppendCStrN(&entry, line + end, length - end);
+    SetCStr(s, "");
+    AppendCStrN(s, entry.str, entry.length);
+    DestroyStr(&entry);
+    printf("%s", s->str);
+    fflush(stdout);
+    return true;
+}
+
+/**
+ * Print the newest count entries with their numbers, or every entry if count is 0.
+**/
+void PrintHistory(history* h, size_t count) {
+    if (h->dataFD < 0) return;
+    flock(h->indexFD, LOCK_SH);
+    if (Refresh(h)) {
+        size_t total = h->header->count;
+        for (size_t n = count > 0 && count < total ? total - count + 1 : 1; n <= total; n++) {
+            history_record* r = Records(h) + n - 1;
+            printf("%5zu  %.*s\n", n, (int) r->length, h->data + r->offset);
+        }
+    }
+    flock(h->indexFD, LOCK_UN);
+}
+
+/**
+ * Unmap and close the history files.
+**/
+void CloseHistory(history* h) {
+    if (h->data) munmap((void*) h->data, h->dataMapped);
+    if (h->header) munmap(h->header, h->indexSize);
+    if (h->table) munmap(h->table, h->tableSize);
+    if (h->dataFD >= 0) close(h->dataFD);
+    if (h->indexFD >= 0) close(h->indexFD);
+    if (h->tableFD >= 0) close(h->tableFD);
+    *h = (history) {-1, -1, -1, NULL, NULL, NULL, 0, 0, 0, 0};
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#ifndef history_h
+#define history_h
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "string/str.h"
+
+// Every prefix of an entry up to this many characters is indexed.
+#define HISTORY_PREFIX 64
+
+/**=================================================================|
+ * The start of a history index file.                               |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * char magic[8] "SMSHHIS2", a file without it is rebuilt.          |
+ * uint64_t count The number of entries.                            |
+ * uint64_t dataEnd The bytes of the history file indexed.          |
+ * uint64_t slots The number of slots in the table file, a power    |
+ *      of two.                                                     |
+ * uint64_t used The number of slots in use.                        |
+ * =================================================================|
+**/
+typedef struct history_header {
+    char magic[8];
+    uint64_t count, dataEnd, slots, used;
+} history_header;
+
+/**=================================================================|
+ * One entry of a history index file, after the header.             |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * uint64_t offset Where the line starts in the history file.       |
+ * uint32_t length The length of the line without its newline.      |
+ * uint32_t previous The number of the previous entry with the same |
+ *      first HISTORY_PREFIX characters or 0.                       |
+ * =================================================================|
+**/
+typedef struct history_record {
+    uint64_t offset;
+    uint32_t length;
+    uint32_t previous;
+} history_record;
+
+/**=================================================================|
+ * A slot of a history table file.                                  |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * uint64_t hash The hash of the prefix.                            |
+ * uint64_t entry The number of the newest entry with the prefix or |
+ *      0 if the slot is empty.                                     |
+ * =================================================================|
+**/
+typedef struct history_slot {
+    uint64_t hash, entry;
+} history_slot;
+
+/**=================================================================|
+ * The shell's command history, shared by every shell using the     |
+ * same files.                                                      |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * The history file holds one line per entry and is only appended   |
+ * to. The index file maps entry numbers to lines and the table     |
+ * file is an open addressed hash table from every prefix of up to  |
+ * HISTORY_PREFIX characters to its newest entry, so finding the    |
+ * newest entry starting with such a prefix is one lookup. A longer |
+ * prefix walks the entries sharing its first HISTORY_PREFIX        |
+ * characters, which each entry links to. All three files are       |
+ * memory mapped so opening the history reads nothing. Appends take |
+ * an exclusive flock of the index file and lookups a shared one,   |
+ * so shells can share the history, and the mappings are refreshed  |
+ * whenever another shell has grown a file.                         |
+ * Entries are numbered from 1.                                     |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * int dataFD, indexFD, tableFD The history, index and table files, |
+ *      -1 if the history could not be opened.                      |
+ * const char* data The mapping of the history file.                |
+ * history_header* header The mapping of the index file.            |
+ * history_slot* table The mapping of the table file.               |
+ * size_t dataSize The size of the history file.                    |
+ * size_t dataMapped The size of the mapping of the history file,   |
+ *      which is larger so the file can grow without a remap.       |
+ * size_t indexSize, tableSize The mapped sizes.                    |
+ * =================================================================|
+**/
+typedef struct history {
+    int dataFD, indexFD, tableFD;
+    const char* data;
+    history_header* header;
+    history_slot* table;
+    size_t dataSize, dataMapped, indexSize, tableSize;
+} history;
+
+bool OpenHistory(history* h, const char* path);
+bool AddHistory(history* h, const char* line, size_t length);
+size_t HistoryLength(history* h);
+size_t GetHistory(history* h, size_t n, string* line);
+size_t FindHistory(history* h, const char* prefix, size_t length);
+bool ExpandHistory(history* h, string* s);
+void PrintHistory(history* h, size_t count);
+void CloseHistory(history* h);
+#endif
\ No newline at end of file
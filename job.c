@@ -0,0 +1,191 @@
+#include "job.h"
+#include "trace.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+/**
+ * Hash a job by its pid.
+**/
+static size_t HashJob(const void* j) {
+    pid_t pid = ((const job*) j)->pid;
+    return HashBytes(&pid, sizeof(pid));
+}
+
+/**
+ * Compare two jobs by their pids.
+**/
+static bool EqualsJob(const void* j1, const void* j2) {
+    return ((const job*) j1)->pid == ((const job*) j2)->pid;
+}
+
+/**
+ * Moves the second job into the first job.
+**/
+static void CopyConstructJob(void* j1, void* j2) {
+    *(job*) j1 = *(job*) j2;
+    CopyConstructStr(&((job*) j1)->name, &((job*) j2)->name);
+    CopyConstructStr(&((job*) j1)->commandLine, &((job*) j2)->commandLine);
+}
+
+/**
+ * Destroy the job's strings.
+**/
+static void DestroyJob(void* j) {
+    DestroyStr(&((job*) j)->name);
+    DestroyStr(&((job*) j)->commandLine);
+}
+
+/**
+ * Hash a job count by its job id.
+**/
+static size_t HashCount(const void* c) {
+    size_t id = ((const job_count*) c)->id;
+    return HashBytes(&id, sizeof(id));
+}
+
+/**
+ * Compare two job counts by their job ids.
+**/
+static bool EqualsCount(const void* c1, const void* c2) {
+    return ((const job_count*) c1)->id == ((const job_count*) c2)->id;
+}
+
+/**
+ * Creates an empty job table.
+**/
+job_table ConstructJobTable() {
+    job_table table = {ConstructMap(sizeof(job), HashJob, EqualsJob, CopyConstructJob, DestroyJob), 1, 0, 0};
+    table.live = ConstructMap(sizeof(job_count), HashCount, EqualsCount, NULL, NULL);
+    ConstructStatsTable(&table.stats);
+    return table;
+}
+
+/**
+ * Add a job for every process of a command line.
+ * @param table The table to add the jobs to.
+ * @param c The command the processes run, stage i is pids[i].
+ * @param pids The pids of the processes, one per pipeline stage.
+ * @param count The number of pids.
+ * @param commandLine The line the processes were started from.
+ * @param background If the shell will not wait for the processes.
+ * @param start When the processes were launched(monotonic) or NULL for now.
+ * @return The job id shared by the processes.
+**/
+size_t AddJob(job_table* table, command* c, pid_t* pids, size_t count, string* commandLine, bool background, struct timespec* start) {
+    job j = {0, table->nextId++, {0}, {0}, {0}, JOB_RUNNING, background, 0};
+    if (start) j.start = *start;
+    else clock_gettime(CLOCK_MONOTONIC, &j.start);
+    for (size_t i = 0; i < count; i++) {
+        j.pid = pids[i];
+        // The line may live in an arena so always copy it onto the heap.
+        ConstructStr(&j.name, (i == 0 ? c : ((command*) c->stages.items) + i - 1)->commandName.str);
+        ConstructStr(&j.commandLine, commandLine->str);
+        PutMap(&table->jobs, &j);
+    }
+    if (background) table->background += count;
+    if (background && count > 0) {
+        job_count live = {j.id, count};
+        PutMap(&table->live, &live);
+        table->backgroundJobs++;
+    }
+    return j.id;
+}
+
+/**
+ * Find the job for a pid.
+ * @return The job or NULL if the pid is not a child of the shell.
+**/
+job* GetJob(job_table* table, pid_t pid) {
+    job probe = {pid};
+    return GetMap(&table->jobs, &probe);
+}
+
+/**
+ * Forget the job for a pid.
+**/
+void RemoveJob(job_table* table, pid_t pid) {
+    job probe = {pid};
+    RemoveMap(&table->jobs, &probe);
+}
+
+/**
+ * Reap every exited child with wait4 so the cost only depends on the
+ *    number of children that exited rather than the number running.
+ * The wall time and rusage of every process is added to the stats table.
+ * Background jobs have their status printed and are removed.
+ * Foreground jobs are marked JOB_DONE for their waiter to remove.
+ * @return The number of background processes reported.
+**/
+size_t ReapJobs(job_table* table) {
+    size_t reported = 0;
+    int status;
+    struct rusage usage;
+    pid_t pid;
+    while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+        TraceInstant(TRACE_REAP, pid);
+        job* j = GetJob(table, pid);
+        if (j == NULL) continue;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t wall = (now.tv_sec - j->start.tv_sec) * 1000000000ULL + now.tv_nsec - j->start.tv_nsec;
+        RecordStats(&table->stats, j->name.str, wall, &usage);
+        if (!j->background) {
+            j->state = JOB_DONE;
+            j->status = status;
+            continue;
+        }
+        if (WIFEXITED(status))
+            printf("The process %d exited normally with status: %d.\n", pid, WEXITSTATUS(status));
+        else if (WIFSIGNALED(status))
+            printf("The process %d was terminated with signal: %d.\n", pid, WTERMSIG(status));
+        fflush(stdout);
+        job_count probe = {j->id};
+        job_count* live = GetMap(&table->live, &probe);
+        if (live && --live->count == 0) {
+            RemoveMap(&table->live, &probe);
+            table->backgroundJobs--;
+        }
+        table->background--;
+        RemoveJob(table, pid);
+        reported++;
+    }
+    return reported;
+}
+
+/**
+ * Print the running background jobs.
+**/
+void PrintJobs(job_table* table) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    size_t index = 0;
+    job* j;
+    while ((j = NextMap(&table->jobs, &index))) {
+        if (!j->background) continue;
+        printf("[%zu] %d running for %lds: %s\n", j->id, j->pid, (long) (now.tv_sec - j->start.tv_sec), j->commandLine.str);
+    }
+    fflush(stdout);
+}
+
+/**
+ * Send a signal to every running background job.
+**/
+void KillJobs(job_table* table, int signal) {
+    size_t index = 0;
+    job* j;
+    while ((j = NextMap(&table->jobs, &index))) {
+        if (j->background && j->state == JOB_RUNNING) kill(j->pid, signal);
+    }
+}
+
+/**
+ * Cleans up the job table.
+**/
+void DestroyJobTable(job_table* table) {
+    DestroyMap(&table->jobs);
+    DestroyMap(&table->live);
+    DestroyStatsTable(&table->stats);
+}
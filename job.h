@@ -0,0 +1,86 @@
+#ifndef job_h
+#define job_h
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "command.h"
+#include "map/map.h"
+#include "stats.h"
+#include "string/str.h"
+
+typedef enum job_state {
+    JOB_RUNNING,
+    JOB_DONE
+} job_state;
+
+/**=================================================================|
+ * A child process started by the shell.                            |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * pid_t pid The pid of the process, the key of the job table.      |
+ * size_t id The job id, shared by every stage of a pipeline.       |
+ * string name The command name of the process's pipeline stage.    |
+ * string commandLine The line the process was started from.        |
+ * struct timespec start When the process was started(monotonic).   |
+ * job_state state If the process is running or has been reaped.    |
+ * bool background If the shell is not waiting for the process.     |
+ * int status The wait status once the process is JOB_DONE.         |
+ * =================================================================|
+**/
+typedef struct job {
+    pid_t pid;
+    size_t id;
+    string name;
+    string commandLine;
+    struct timespec start;
+    job_state state;
+    bool background;
+    int status;
+} job;
+
+/**=================================================================|
+ * The number of running processes of a background job.             |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * size_t id The job id, the key of job_table::live.                |
+ * size_t count The processes of the job not yet reaped.            |
+ * =================================================================|
+**/
+typedef struct job_count {
+    size_t id;
+    size_t count;
+} job_count;
+
+/**=================================================================|
+ * Every child process of the shell keyed by pid.                   |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * map jobs The job structs keyed by job::pid.                      |
+ * size_t nextId The id given to the next job added.                |
+ * size_t background The number of running background processes.    |
+ * size_t backgroundJobs The number of background job ids with a    |
+ *      running process, what the job queue limits.                 |
+ * map live The job_count of every background job id with a running |
+ *      process so a reap finds if it was the job's last in O(1).   |
+ * stats_table stats The resources used by every reaped process.    |
+ * =================================================================|
+**/
+typedef struct job_table {
+    map jobs;
+    size_t nextId;
+    size_t background;
+    size_t backgroundJobs;
+    map live;
+    stats_table stats;
+} job_table;
+
+job_table ConstructJobTable();
+size_t AddJob(job_table* table, command* c, pid_t* pids, size_t count, string* commandLine, bool background, struct timespec* start);
+job* GetJob(job_table* table, pid_t pid);
+void RemoveJob(job_table* table, pid_t pid);
+size_t ReapJobs(job_table* table);
+void PrintJobs(job_table* table);
+void KillJobs(job_table* table, int signal);
+void DestroyJobTable(job_table* table);
+#endif
\ No newline at end of file
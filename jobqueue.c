@@ -0,0 +1,133 @@
+#include "jobqueue.h"
+
+#include <stdio.h>
+
+/**
+ * If queued job a should start before queued job b.
+**/
+static bool Before(queued_job* a, queued_job* b) {
+    return a->priority < b->priority || (a->priority == b->priority && a->ticket < b->ticket);
+}
+
+/**
+ * Move the job at index up the heap until its parent starts before it.
+**/
+static size_t SiftUp(job_queue* queue, size_t index) {
+    queued_job** heap = queue->heap.items;
+    while (index > 0 && Before(heap[index], heap[(index - 1) / 2])) {
+        queued_job* temp = heap[index];
+        heap[index] = heap[(index - 1) / 2];
+        heap[(index - 1) / 2] = temp;
+        index = (index - 1) / 2;
+    }
+    return index;
+}
+
+/**
+ * Move the job at index down the heap until it starts before its children.
+**/
+static void SiftDown(job_queue* queue, size_t index) {
+    queued_job** heap = queue->heap.items;
+    size_t length = queue->heap.length;
+    while (true) {
+        size_t first = index, left = 2 * index + 1, right = left + 1;
+        if (left < length && Before(heap[left], heap[first])) first = left;
+        if (right < length && Before(heap[right], heap[first])) first = right;
+        if (first == index) return;
+        queued_job* temp = heap[index];
+        heap[index] = heap[first];
+        heap[first] = temp;
+        index = first;
+    }
+}
+
+/**
+ * Initialize an empty queue.
+ * @param queue The queue to initialize.
+ * @param limit The max running background jobs, 0 for no limit.
+**/
+void ConstructJobQueue(job_queue* queue, size_t limit) {
+    queue->heap = ConstructVector(sizeof(queued_job*), NULL, NULL);
+    queue->limit = limit;
+    queue->priority = 0;
+    queue->nextTicket = 1;
+}
+
+/**
+ * Queue a copy of a command until a background slot frees.
+ * @param queue The queue to add to.
+ * @param c The command, it is copied so it may live in an arena.
+ * @param commandLine The line the command was parsed from, also copied.
+ * @param priority The nice value to start the command with.
+ * @return The ticket of the queued command.
+**/
+size_t EnqueueJob(job_queue* queue, command* c, string* commandLine, int priority) {
+    queued_job* job = malloc(sizeof(queued_job));
+    job->ticket = queue->nextTicket++;
+    job->priority = priority;
+    DeepCopyCommand(&job->c, c, NULL);
+    ConstructStr(&job->commandLine, commandLine->str);
+    PushBackVector(&queue->heap, &job);
+    SiftUp(queue, queue->heap.length - 1);
+    return job->ticket;
+}
+
+/**
+ * Take the next job to start off the queue.
+ * @return The job which the caller must destroy, or NULL if the queue is empty.
+**/
+queued_job* DequeueJob(job_queue* queue) {
+    if (queue->heap.length == 0) return NULL;
+    queued_job** heap = queue->heap.items;
+    queued_job* job = heap[0];
+    heap[0] = heap[--queue->heap.length];
+    SiftDown(queue, 0);
+    return job;
+}
+
+/**
+ * Change the priority of a queued job.
+ * @return False if no queued job has the ticket.
+**/
+bool PrioritizeJob(job_queue* queue, size_t ticket, int priority) {
+    queued_job** heap = queue->heap.items;
+    for (size_t i = 0; i < queue->heap.length; i++) {
+        if (heap[i]->ticket != ticket) continue;
+        heap[i]->priority = priority;
+        SiftDown(queue, SiftUp(queue, i));
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Print the limit and the queued jobs in heap order.
+ * @param running The number of background jobs running now.
+**/
+void PrintJobQueue(job_queue* queue, size_t running) {
+    if (queue->limit > 0) printf("%zu of %zu background jobs running, %zu queued.\n", running, queue->limit, queue->heap.length);
+    else printf("%zu background jobs running, no limit.\n", running);
+    queued_job** heap = queue->heap.items;
+    for (size_t i = 0; i < queue->heap.length; i++)
+        printf("[%zu] priority %d: %s\n", heap[i]->ticket, heap[i]->priority, heap[i]->commandLine.str);
+    fflush(stdout);
+}
+
+/**
+ * Free a job taken off the queue.
+**/
+void DestroyQueuedJob(queued_job* job) {
+    DestroyCommand(&job->c);
+    DestroyStr(&job->commandLine);
+    free(job);
+}
+
+/**
+ * Free the queue and every job still waiting in it.
+**/
+void DestroyJobQueue(job_queue* queue) {
+    queued_job** heap = queue->heap.items;
+    for (size_t i = 0; i < queue->heap.length; i++)
+        DestroyQueuedJob(heap[i]);
+    DestroyVector(&queue->heap);
+}
@@ -0,0 +1,57 @@
+#ifndef jobqueue_h
+#define jobqueue_h
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "command.h"
+#include "string/str.h"
+#include "vector/vector.h"
+
+/**=================================================================|
+ * A background command waiting for a free slot.                    |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * size_t ticket The order the command was queued in.               |
+ * int priority The nice value the command is started with, lower   |
+ *      values are started first.                                   |
+ * command c A heap copy of the parsed and expanded command.        |
+ * string commandLine The line the command was parsed from.         |
+ * =================================================================|
+**/
+typedef struct queued_job {
+    size_t ticket;
+    int priority;
+    command c;
+    string commandLine;
+} queued_job;
+
+/**=================================================================|
+ * Background commands waiting to start ordered by priority.        |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * A binary heap of queued_job pointers so the inline strings of    |
+ * the commands never move. Equal priorities keep their FIFO order  |
+ * by ticket.                                                       |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * vector heap The queued_job* heap, the next to start is first.    |
+ * size_t limit The max running background jobs, 0 for no limit.    |
+ * int priority The priority given to new background commands.      |
+ * size_t nextTicket The ticket given to the next queued command.   |
+ * =================================================================|
+**/
+typedef struct job_queue {
+    vector heap;
+    size_t limit;
+    int priority;
+    size_t nextTicket;
+} job_queue;
+
+void ConstructJobQueue(job_queue* queue, size_t limit);
+size_t EnqueueJob(job_queue* queue, command* c, string* commandLine, int priority);
+queued_job* DequeueJob(job_queue* queue);
+bool PrioritizeJob(job_queue* queue, size_t ticket, int priority);
+void PrintJobQueue(job_queue* queue, size_t running);
+void DestroyQueuedJob(queued_job* job);
+void DestroyJobQueue(job_queue* queue);
+#endif
\ No newline at end of file
@@ -0,0 +1,312 @@
+#define _GNU_SOURCE
+#include "launch.h"
+#include "builtins.h"
+#include "trace.h"
+#include "zygote.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+/**
+ * Parse a backend name(fork, vfork, spawn or zygote) into backend.
+ * Returns false if the name is not a known backend.
+**/
+bool ParseLaunchBackend(const char* name, launch_backend* backend) {
+    if (strcmp(name, "fork") == 0) *backend = LAUNCH_FORK;
+    else if (strcmp(name, "vfork") == 0) *backend = LAUNCH_VFORK;
+    else if (strcmp(name, "spawn") == 0) *backend = LAUNCH_SPAWN;
+    else if (strcmp(name, "zygote") == 0) *backend = LAUNCH_ZYGOTE;
+    else return false;
+    return true;
+}
+
+/**
+ * Set the SIGINT handler to HandleSIGINT.
+ * Set the SIGTSTP handler to HandleSIGTSTP.
+**/
+void SetupSigHandlers(void (*HandleSIGINT)(int), void (*HandleSIGTSTP)(int)) {
+    struct sigaction sigInt = {0};
+    sigInt.sa_handler = HandleSIGINT;
+    sigfillset(&sigInt.sa_mask);
+    sigInt.sa_flags = 0;
+    sigaction(SIGINT, &sigInt, NULL);
+
+    struct sigaction sigTstp = {0};
+    sigTstp.sa_handler = HandleSIGTSTP;
+    sigfillset(&sigTstp.sa_mask);
+    sigTstp.sa_flags = 0;
+    sigaction(SIGTSTP, &sigTstp, NULL);
+}
+
+/**
+ * Open the command::inOut strings as files if possible and
+ *    use dup2() to map them to stdin and stdout and return false.
+ * If not possible print error messages and return true.
+ * A NULL inFD or outFD skips that redirection, which is how the
+ *    middle stages of a pipeline keep their pipe ends.
+ * Messages are written with dprintf so this is safe to call from a vfork child.
+**/
+bool PerformIO(command* c, int* inFD, int* outFD) {
+    int badIO = 0;
+    pid_t pid = GTrace ? getpid() : 0;
+    if (GTrace) TraceRecord(TRACE_REDIRECT, 'B', pid, 0);
+    if (inFD && c->inOut[0].length > 0) {
+        if ((*inFD = open(c->inOut[0].str, O_RDONLY, 0760)) < 0) badIO |= 1;
+        else if (dup2(*inFD, 0) < 0) badIO |= 5;
+    }
+    if (outFD && c->inOut[1].length > 0) {
+        if ((*outFD = open(c->inOut[1].str, O_WRONLY | O_CREAT | O_TRUNC, 0760)) < 0) badIO |= 2;
+        else if (dup2(*outFD, 1) < 0) badIO |= 10;
+    }
+
+    if (badIO & 1) dprintf(1, badIO & 4 ? "Could no dup2 input.\n" : "Could not open file %s for input.\n", c->inOut[0].str);
+    if (badIO & 2) dprintf(1, badIO & 8 ? "Could no dup2 output.\n" : "Could not open file %s for output.\n", c->inOut[1].str);
+    if (GTrace) TraceRecord(TRACE_REDIRECT, 'E', pid, badIO);
+    return badIO;
+}
+
+/**
+ * Construct a char** array where the first char* is
+ *    the command name and the rest are the args and the last
+ *    is NULL. It is allocated from the command's memory manager.
+**/
+char** ConstructExecArgs(command* c) {
+    char** args = Alloc(c->args.manager, sizeof(char*) * (c->args.length + 2));
+    args[0] = c->commandName.str;
+    for (int i = 0; i < c->args.length; i++)
+        args[i + 1] = ((string*) c->args.items)[i].str;
+    args[c->args.length + 1] = NULL;
+    return args;
+}
+
+/**
+ * Build command::execArgs for every stage of the command and of each
+ *    command in its list. Only call once its strings will not move anymore.
+**/
+void BuildExecArgs(command* c) {
+    c->execArgs = ConstructExecArgs(c);
+    for (size_t i = 0; i < c->stages.length; i++) {
+        command* stage = ((command*) c->stages.items) + i;
+        stage->execArgs = ConstructExecArgs(stage);
+    }
+    for (size_t i = 0; i < c->sequence.length; i++)
+        BuildExecArgs(((command*) c->sequence.items) + i);
+}
+
+/**
+ * Set up a child for its stage: reset the signals, apply the placement and
+ *    connect the pipes, errorFD and head's redirections.
+ * pipeIn and pipeOut are the pipe ends for this stage or -1.
+ * head holds the redirections which only apply to the first and last stage.
+ * Returns false if the stage's stdio could not be set up.
+**/
+static bool PrepareChild(command* head, int pipeIn, int pipeOut, launch_options* options) {
+    if (options->background) SetupSigHandlers(SIG_IGN, SIG_IGN);
+    else SetupSigHandlers(SIG_DFL, SIG_IGN);
+    // The shell blocks the signals it reads from its signalfd so unblock everything.
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+    // Placed before exec so every thread the command starts inherits it.
+    if (options->cpus) ApplyPlacement(0, options->cpus, options->nodes);
+    int inFD = -1, outFD = -1;
+    return (pipeIn < 0 || dup2(pipeIn, 0) >= 0) && (pipeOut < 0 || dup2(pipeOut, 1) >= 0) && (options->errorFD < 0 || dup2(options->errorFD, 2) >= 0)
+        && !PerformIO(head, pipeIn < 0 ? &inFD : NULL, pipeOut < 0 ? &outFD : NULL);
+}
+
+/**
+ * The child half of the fork, vfork and zygote backends.
+ * path is the cached location of the command or NULL. If execve on it fails
+ *    the errno is stored in execError, which a vfork parent sees, and PATH
+ *    is searched instead.
+ * A vfork child shares the shell's memory until exec succeeds so nothing here
+ *    allocates or touches stdio buffers. dprintf and execvpe are not on the
+ *    async-signal-safe list but glibc's format and search on the stack.
+**/
+void ExecChild(command* head, char** args, const char* path, int pipeIn, int pipeOut, launch_options* options, volatile int* execError) {
+    if (PrepareChild(head, pipeIn, pipeOut, options)) {
+        if (GTrace) TraceRecord(TRACE_EXEC, 'i', getpid(), 0);
+        if (path) {
+            execve(path, args, options->envp);
+            *execError = errno;
+        }
+        execvpe(args[0], args, options->envp);
+        dprintf(1, "No such file or directory named %s.\n", args[0]);
+    }
+    _exit(1);
+}
+
+/**
+ * Run a builtin stage in a fork of the shell, whatever the backend, since
+ *    there is no program to exec. The child exits with the builtin's status.
+**/
+static pid_t ForkBuiltin(command* head, command* stage, const builtin* b, int pipeIn, int pipeOut, launch_options* options) {
+    TraceBegin(TRACE_FORK, 0);
+    sigset_t all, old;
+    sigfillset(&all);
+    sigprocmask(SIG_SETMASK, &all, &old);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int status = 1;
+        if (PrepareChild(head, pipeIn, pipeOut, options)) status = b->Run(options->sh, stage);
+        fflush(stdout);
+        _exit(status & 0xff);
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    if (pid < 0) {
+        printf("Could not fork. Command %s will not run.\n", stage->commandName.str);
+        fflush(stdout);
+    }
+    TraceEnd(TRACE_FORK, pid);
+    return pid;
+}
+
+/**
+ * Open the command::inOut strings as close-on-exec files for posix_spawn.
+ * Like PerformIO a NULL inFD or outFD skips that redirection.
+ * Prints the same messages as PerformIO and returns true on failure.
+**/
+static bool OpenIO(command* c, int* inFD, int* outFD) {
+    bool badIO = false;
+    TraceBegin(TRACE_REDIRECT, 0);
+    if (inFD && c->inOut[0].length > 0 && (*inFD = open(c->inOut[0].str, O_RDONLY | O_CLOEXEC)) < 0) {
+        printf("Could not open file %s for input.\n", c->inOut[0].str);
+        badIO = true;
+    } else if (outFD && c->inOut[1].length > 0 && (*outFD = open(c->inOut[1].str, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0760)) < 0) {
+        printf("Could not open file %s for output.\n", c->inOut[1].str);
+        badIO = true;
+    }
+    TraceEnd(TRACE_REDIRECT, badIO);
+    return badIO;
+}
+
+/**
+ * Launch one stage with posix_spawn on path, or posix_spawnp if path is NULL
+ *    or no longer runs in which case it is dropped from the cache.
+ * SIGINT and SIGTSTP are ignored by the shell so they are inherited as ignored
+ *    except SIGINT in the foreground where it is reset to the default.
+ * The signals the shell blocks for its signalfd are unblocked.
+ * posix_spawn has no affinity attribute so the child is pinned right after it
+ *    starts and its memory cannot be bound to NUMA nodes.
+**/
+static pid_t SpawnCommand(command* head, char** args, const char* path, int pipeIn, int pipeOut, launch_options* options) {
+    pid_t pid = -1;
+    int inFD = -1, outFD = -1;
+    if (OpenIO(head, pipeIn < 0 ? &inFD : NULL, pipeOut < 0 ? &outFD : NULL)) goto close_io;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attr);
+    if (pipeIn >= 0 || inFD >= 0) posix_spawn_file_actions_adddup2(&actions, pipeIn >= 0 ? pipeIn : inFD, 0);
+    if (pipeOut >= 0 || outFD >= 0) posix_spawn_file_actions_adddup2(&actions, pipeOut >= 0 ? pipeOut : outFD, 1);
+    if (options->errorFD >= 0) posix_spawn_file_actions_adddup2(&actions, options->errorFD, 2);
+    sigset_t defaults, mask;
+    sigemptyset(&defaults);
+    if (!options->background) sigaddset(&defaults, SIGINT);
+    sigemptyset(&mask);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+    int error = path ? posix_spawn(&pid, path, &actions, &attr, args, options->envp) : ENOENT;
+    if (path && (error == ENOENT || error == EACCES || error == ENOEXEC)) ForgetPath(options->paths, args[0]);
+    if (path == NULL || error == ENOENT || error == EACCES || error == ENOEXEC)
+        error = posix_spawnp(&pid, args[0], &actions, &attr, args, options->envp);
+    if (error != 0) {
+        pid = -1;
+        if (error == ENOENT || error == EACCES) printf("No such file or directory named %s.\n", args[0]);
+        else printf("Could not spawn. Command %s will not run.\n", args[0]);
+    } else if (options->cpus) {
+        ApplyPlacement(pid, options->cpus, 0);
+    }
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+close_io:
+    if (inFD >= 0) close(inFD);
+    if (outFD >= 0) close(outFD);
+    fflush(stdout);
+    return pid;
+}
+
+/**
+ * Start a single stage in a child process using the given backend.
+**/
+static pid_t LaunchStage(command* head, command* stage, int pipeIn, int pipeOut, launch_options* options) {
+    const builtin* b = options->sh ? FindBuiltin(stage->commandName.str, stage->commandName.length) : NULL;
+    if (b && ForksBuiltin(b)) return ForkBuiltin(head, stage, b, pipeIn, pipeOut, options);
+    char** args = stage->execArgs ? stage->execArgs : ConstructExecArgs(stage);
+    const char* path = options->paths ? LookupPath(options->paths, args[0], options->searchPath) : NULL;
+    // Only vfork and spawn see a failed exec of the cached path so the others check it first.
+    if (path && (options->backend == LAUNCH_FORK || options->backend == LAUNCH_ZYGOTE) && access(path, X_OK) < 0) {
+        ForgetPath(options->paths, args[0]);
+        path = LookupPath(options->paths, args[0], options->searchPath);
+    }
+    pid_t pid = -1;
+    TraceBegin(TRACE_FORK, 0);
+    // A pre-forked helper execs the stage, or it is forked if none is ready.
+    if (options->backend == LAUNCH_ZYGOTE && options->zygotes)
+        pid = LaunchZygote(options->zygotes, head, args, path, pipeIn, pipeOut, options->errorFD, options->background, options->cpus, options->nodes, options->envp);
+    if (pid > 0) {
+        // The helper was forked while the shell was idle.
+    } else if (options->backend == LAUNCH_SPAWN) {
+        pid = SpawnCommand(head, args, path, pipeIn, pipeOut, options);
+    } else {
+        // Only a vfork child can report a failed execve since it shares our memory.
+        volatile int execError = 0;
+        // Block every signal so no shell handler runs in the child before it resets them.
+        sigset_t all, old;
+        sigfillset(&all);
+        sigprocmask(SIG_SETMASK, &all, &old);
+        pid = options->backend == LAUNCH_VFORK ? vfork() : fork();
+        if (pid == 0) ExecChild(head, args, path, pipeIn, pipeOut, options, &execError);
+        sigprocmask(SIG_SETMASK, &old, NULL);
+        if (execError != 0) ForgetPath(options->paths, args[0]);
+        if (pid < 0) {
+            printf("Could not fork. Command %s will not run.\n", args[0]);
+            fflush(stdout);
+        }
+    }
+    TraceEnd(TRACE_FORK, pid);
+    if (args != stage->execArgs) Free(stage->args.manager, args);
+    return pid;
+}
+
+/**
+ * Start every stage of the command in child processes as described by options.
+ * Stages are joined with close-on-exec pipes and the shell closes each end
+ *    as soon as the stage using it has started so data streams between them.
+ * The last stage writes to launch_options::outputFD if it is set.
+ * pids must have room for 1 + command::stages.length pids.
+ * Returns the number of stages started. A stage that could not start has
+ *    already printed a message and the stages after it are not started.
+**/
+size_t LaunchCommand(command* c, launch_options* options, pid_t* pids) {
+    size_t count = 1 + c->stages.length, started = 0;
+    int pipeIn = -1;
+    // Output the shell has buffered comes before the child's.
+    fflush(stdout);
+    for (size_t i = 0; i < count; i++) {
+        command* stage = i == 0 ? c : ((command*) c->stages.items) + i - 1;
+        int ends[2] = {-1, -1};
+        if (i + 1 < count && pipe2(ends, O_CLOEXEC) < 0) {
+            printf("Could not create a pipe. Command %s will not run.\n", stage->commandName.str);
+            fflush(stdout);
+            break;
+        }
+        pids[i] = LaunchStage(c, stage, pipeIn, i + 1 < count ? ends[1] : options->outputFD, options);
+        if (pipeIn >= 0) close(pipeIn);
+        if (ends[1] >= 0) close(ends[1]);
+        pipeIn = ends[0];
+        if (pids[i] < 0) break;
+        started++;
+    }
+    if (pipeIn >= 0) close(pipeIn);
+    return started;
+}
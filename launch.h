@@ -0,0 +1,70 @@
+#ifndef launch_h
+#define launch_h
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "command.h"
+#include "pathcache.h"
+#include "placement.h"
+#include "zygote.h"
+
+struct shell;
+
+/**
+ * The mechanism used to create the child process for a command.
+ * LAUNCH_FORK Copies the shell with fork() then execs.
+ * LAUNCH_VFORK Borrows the shell's address space with vfork() until exec.
+ * LAUNCH_SPAWN Uses posix_spawnp() with file and signal actions.
+ * LAUNCH_ZYGOTE Hands the command to a helper forked ahead of time
+ *    and forks if no helper is ready.
+**/
+typedef enum launch_backend {
+    LAUNCH_FORK,
+    LAUNCH_VFORK,
+    LAUNCH_SPAWN,
+    LAUNCH_ZYGOTE
+} launch_backend;
+
+/**=================================================================|
+ * How LaunchCommand should start a command.                        |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * launch_backend backend The mechanism used to create children.    |
+ * bool background If the children ignore SIGINT.                   |
+ * char** envp The NULL terminated environment of the children.     |
+ * path_cache* paths Where commands are looked up or NULL to let    |
+ *      exec search PATH every time.                                |
+ * const char* searchPath The PATH used with paths.                 |
+ * zygote_pool* zygotes The helpers used by LAUNCH_ZYGOTE or NULL.  |
+ * int outputFD Where the last stage writes instead of its '>' or   |
+ *      -1 to use it.                                               |
+ * int errorFD Where every stage's stderr goes or -1 to inherit the |
+ *      shell's.                                                    |
+ * const cpu_mask* cpus The CPUs every stage is pinned to or NULL.  |
+ * unsigned long nodes The NUMA nodes the memory of every stage is  |
+ *      bound to, one bit per node, or 0.                           |
+ * struct shell* sh The shell forked to run builtins with no        |
+ *      program of their own or NULL.                               |
+ * =================================================================|
+**/
+typedef struct launch_options {
+    launch_backend backend;
+    bool background;
+    char** envp;
+    path_cache* paths;
+    const char* searchPath;
+    zygote_pool* zygotes;
+    int outputFD, errorFD;
+    const cpu_mask* cpus;
+    unsigned long nodes;
+    struct shell* sh;
+} launch_options;
+
+bool ParseLaunchBackend(const char* name, launch_backend* backend);
+void SetupSigHandlers(void (*HandleSIGINT)(int), void (*HandleSIGTSTP)(int));
+bool PerformIO(command* c, int* inFD, int* outFD);
+char** ConstructExecArgs(command* c);
+void BuildExecArgs(command* c);
+void ExecChild(command* head, char** args, const char* path, int pipeIn, int pipeOut, launch_options* options, volatile int* execError);
+size_t LaunchCommand(command* c, launch_options* options, pid_t* pids);
+#endif
\ No newline at end of file
@@ -1,5 +1,6 @@
-#include <pwd.h>
+#define _GNU_SOURCE
 #include <fcntl.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdio.h>
 #include <string.h>
@@ -7,214 +8,531 @@
 #include <memory.h>
 #include <unistd.h>
 #include <errno.h>
+#include <poll.h>
+#include <pwd.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
 
+#include "builtins.h"
 #include "command.h"
+#include "launch.h"
+#include "script.h"
+#include "shell.h"
+#include "trace.h"
 
 /**
- * Wait for the current foreground child process then
- *    change the foregroundOnly mode and alert the user.
-**/
-void HandleSIGTSTP(int sigID) {
-    char FLAG[129] = "4u7x!A%D*G-KaPdSgVkYp3s6v8y/B?E(H+MbQeThWmZq4t7w!z$C&F)J@NcRfUjXn2r5u8x/A?D*G-KaPdSgVkYp3s6v9y$B&E)H+MbQeThWmZq4t7w!z%C*F-JaNcRf";
-    void* walker = FLAG + 1;
-    // Walk the stack until we find the first occurence of the FLAG(should be in main).
-    while (memcmp(walker++, FLAG, sizeof(FLAG)) != 0);
-    pid_t* parentPid = walker + 139; // The parentPid variable in main.
-    if (*parentPid == getpid()) {
-        int status;
-        pid_t* childPid = parentPid + 1; // The childPid variable in main.
-        if (*childPid != -1)
-            waitpid(*childPid, &status, 0);
-        const char foregroundOnly[] = "\nWe've entered forground-only mode.\n";
-        const char backgroundAllowed[] = "\nWe've left foreground-only mode.\n";
-        bool* foregroundOnlyPtr = walker + 150; // The foregroundOnly variable in main.
-        *foregroundOnlyPtr = !(*foregroundOnlyPtr);
-        if (*foregroundOnlyPtr)
-            write(1, foregroundOnly, sizeof(foregroundOnly));
-        else
-            write(1, backgroundAllowed, sizeof(backgroundAllowed));
-        size_t* commandCount = walker + 151;
-        char message[32] = {0};
-        sprintf(message, ": ", *commandCount);
-        write(1, message, strlen(message));
-    }
+ * The PATH searched when the variable is unset, the same as execvp.
+**/
+static const char* DefaultSearchPath = "/bin:/usr/bin";
+
+/**
+ * Get the PATH commands are looked up in.
+**/
+const char* GetSearchPath(shell* sh) {
+    const char* searchPath = GetVariable(&sh->vars, "PATH", 4);
+    return searchPath ? searchPath : DefaultSearchPath;
+}
+
+/**
+ * Store the wait status of the last foreground process and set "$?" from it.
+**/
+void SetStatus(shell* sh, int status) {
+    char value[12];
+    sh->status = status;
+    sprintf(value, "%d", WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+    SetVariable(&sh->vars, "?", 1, value, false);
+}
+
+/**
+ * Change the foregroundOnly mode and alert the user.
+**/
+void ToggleForegroundOnly(shell* sh) {
+    sh->foregroundOnly = !sh->foregroundOnly;
+    if (sh->foregroundOnly) printf("\nWe've entered forground-only mode.\n");
+    else printf("\nWe've left foreground-only mode.\n");
     fflush(stdout);
-    memset(FLAG, 0, sizeof(FLAG));
 }
 
 /**
- * Set the SIGINT handler to HandleSIGINT.
- * Set the SIGTSTP handler to HandleSIGTSTP.
+ * Launch a command and add its processes to the job table.
+ * Background processes are given the priority as their nice value
+ *    and pinned to the CPUs chosen by shell::placement.
+ * pids must have room for 1 + command::stages.length pids.
+ * Returns the number of stages started.
 **/
-void SetupSigHandlers(void (*HandleSIGINT)(int), void (*HandleSIGTSTP)(int)) {
-    struct sigaction sigInt = {0};
-    sigInt.sa_handler = HandleSIGINT;
-    sigfillset(&sigInt.sa_mask);
-    sigInt.sa_flags = 0;
-    sigaction(SIGINT, &sigInt, NULL);
+size_t StartJob(shell* sh, command* c, string* line, bool background, int priority, pid_t* pids) {
+    launch_options options = {sh->backend, background, GetEnvironment(&sh->vars), &sh->paths, GetSearchPath(sh), &sh->zygotes, -1, -1, NULL, 0, sh};
+    // A captured job writes its stderr, and its stdout unless it is redirected to a file, into a pipe.
+    int capture[2] = {-1, -1};
+    if (background && sh->captures.size > 0 && pipe2(capture, O_CLOEXEC) == 0) {
+        options.errorFD = capture[1];
+        if (strcmp(c->inOut[1].str, "/dev/null") == 0) options.outputFD = capture[1];
+    }
+    cpu_mask cpus;
+    if (background && PlaceJob(&sh->placement, &cpus, &options.nodes)) options.cpus = &cpus;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t started = LaunchCommand(c, &options, pids);
+    size_t id = AddJob(&sh->jobs, c, pids, started, line, background, &start);
+    if (capture[1] >= 0) close(capture[1]);
+    if (capture[0] >= 0 && started > 0) AddCapture(&sh->captures, id, pids[started - 1], capture[0], line);
+    else if (capture[0] >= 0) close(capture[0]);
+    for (size_t i = 0; background && i < started; i++) {
+        if (setpriority(PRIO_PROCESS, pids[i], priority) < 0)
+            printf("Could not set the priority of %d to %d.\n", pids[i], priority);
+    }
+    return started;
+}
 
-    struct sigaction sigTstp = {0};
-    sigTstp.sa_handler = HandleSIGTSTP;
-    sigfillset(&sigTstp.sa_mask);
-    sigTstp.sa_flags = 0;
-    sigaction(SIGTSTP, &sigTstp, NULL);
+/**
+ * Start queued background jobs until the limit is reached or the queue is empty.
+ * Returns the number of jobs started.
+**/
+size_t StartQueuedJobs(shell* sh) {
+    size_t count = 0;
+    queued_job* next;
+    while ((sh->queue.limit == 0 || sh->jobs.backgroundJobs < sh->queue.limit) && (next = DequeueJob(&sh->queue))) {
+        pid_t pids[1 + next->c.stages.length];
+        size_t started = StartJob(sh, &next->c, &next->commandLine, true, next->priority, pids);
+        if (started > 0) printf("The queued job %zu is background process %d.\n", next->ticket, pids[started - 1]);
+        fflush(stdout);
+        DestroyQueuedJob(next);
+        count++;
+    }
+    return count;
 }
 
 /**
- * Perform the cd command using chdir.
+ * Drain the signalfd. SIGTSTPs are counted in shell::pendingToggles,
+ *    SIGINT sets shell::interrupted and on SIGCHLD exited children are reaped and queued jobs started.
+ * The output of captured jobs is read as well.
+ * Returns the number of background processes reported or started.
 **/
-void CommandCD(command* c) {
-    if (c->args.length > 0) {
-        if (chdir(((string*) c->args.items)[0].str) < 0)
-            printf("No such directory %s.\n", ((string*) c->args.items)[0].str);
-    } else {
-        const char* homeDir = getenv("HOME");
-        if (homeDir == NULL) homeDir = getpwuid(getuid())->pw_dir;
-        if (chdir(homeDir) < 0)
-            printf("No such directory %s.\n", homeDir);
+size_t HandleSignals(shell* sh) {
+    struct signalfd_siginfo info[16];
+    ssize_t bytes;
+    bool childExited = false;
+    while ((bytes = read(sh->signalFD, info, sizeof(info))) > 0) {
+        for (size_t i = 0; i < bytes / sizeof(*info); i++) {
+            if (info[i].ssi_signo == SIGTSTP) sh->pendingToggles++;
+            else if (info[i].ssi_signo == SIGINT) sh->interrupted = true;
+            else if (info[i].ssi_signo == SIGCHLD) childExited = true;
+        }
     }
+    DrainCaptures(&sh->captures);
+    return childExited ? ReapJobs(&sh->jobs) + StartQueuedJobs(sh) : 0;
 }
 
 /**
- * Open the command::inOut strings as files if possible and
- *    use dup2() to map them to stdin and stdout and return false.
- * If not possible print error messages and return true.
+ * Handle signals received while waiting at the prompt.
+ * Mode changes and exited background processes are reported
+ *    right away and the prompt is printed again.
 **/
-bool PerformIO(command* c, int* inFD, int* outFD) {
-    int badIO = 0;
-    if (c->inOut[0].length > 0) {
-        if ((*inFD = open(c->inOut[0].str, O_RDONLY, 0760)) < 0) badIO |= 1;
-        else if (dup2(*inFD, 0) < 0) badIO |= 5;
+void HandleIdleSignals(shell* sh) {
+    size_t reported = HandleSignals(sh);
+    for (; sh->pendingToggles > 0; sh->pendingToggles--) {
+        ToggleForegroundOnly(sh);
+        reported++;
     }
-    if (c->inOut[1].length > 0) {
-        if ((*outFD = open(c->inOut[1].str, O_WRONLY | O_CREAT | O_TRUNC, 0760)) < 0) badIO |= 2;
-        else if (dup2(*outFD, 1) < 0) badIO |= 10;
+    if (reported > 0 && sh->interactive) {
+        printf(": ");
+        fflush(stdout);
     }
+}
 
-    if (badIO & 1) printf(badIO & 4 ? "Could no dup2 input.\n" : "Could not open file %s for input.\n", c->inOut[0].str);
-    if (badIO & 2) printf(badIO & 8 ? "Could no dup2 output.\n" : "Could not open file %s for output.\n", c->inOut[1].str);
-    return badIO;
+/**
+ * Wait for the foreground pids to die while still reporting background processes.
+ * The last pid's wait status is stored in shell::status.
+ * SIGTSTPs received while waiting change the mode once every pid has died.
+**/
+void WaitForeground(shell* sh, pid_t* pids, size_t count) {
+    size_t remaining = count;
+    // Captured background jobs are drained while waiting so they do not block on a full pipe.
+    struct pollfd signals[2] = {{sh->signalFD, POLLIN, 0}, {sh->captures.epollFD, POLLIN, 0}};
+    TraceBegin(TRACE_WAIT, count > 0 ? pids[count - 1] : 0);
+    while (true) {
+        for (size_t i = 0; i < count; i++) {
+            job* j = pids[i] > 0 ? GetJob(&sh->jobs, pids[i]) : NULL;
+            if (j != NULL && j->state == JOB_DONE) {
+                if (i == count - 1) SetStatus(sh, j->status);
+                RemoveJob(&sh->jobs, pids[i]);
+                pids[i] = -pids[i];
+                remaining--;
+            }
+        }
+        if (remaining == 0) break;
+        poll(signals, 2, -1);
+        HandleSignals(sh);
+    }
+    TraceEnd(TRACE_WAIT, count > 0 ? -pids[count - 1] : 0);
+    for (; sh->pendingToggles > 0; sh->pendingToggles--)
+        ToggleForegroundOnly(sh);
 }
 
 /**
- * Construct a char** array where the first char* is
- *    the command name and the rest are the args and the last
- *    is NULL.
+ * Read more of shell::inputFD into shell::input.
+ * The bytes not yet run are moved to the front first and input is doubled
+ *    when they fill it, so a line is never split.
+ * Sets shell::inputClosed at end of file.
 **/
-char** ConstructExecArgs(command* c) {
-    char** args = malloc(sizeof(char*) * (c->args.length + 2));
-    args[0] = c->commandName.str;
-    for (int i = 0; i < c->args.length; i++)
-        args[i + 1] = ((string*) c->args.items)[i].str;
-    args[c->args.length + 1] = NULL;
-    return args;
+void ReadInput(shell* sh) {
+    if (sh->inputStart > 0) {
+        memmove(sh->input, sh->input + sh->inputStart, sh->inputLength);
+        sh->inputStart = 0;
+    }
+    if (sh->inputSize - sh->inputLength < SHELL_READ_SIZE) {
+        sh->inputSize *= 2;
+        sh->input = realloc(sh->input, sh->inputSize);
+    }
+    ssize_t bytes = read(sh->inputFD, sh->input + sh->inputLength, sh->inputSize - sh->inputLength);
+    if (bytes > 0) sh->inputLength += bytes;
+    else if (bytes == 0 || errno != EINTR) sh->inputClosed = true;
 }
 
 /**
- * Iterate over the background pids and if they have exited
- *    print their status and remove from vector.
+ * Take the next whole line out of the bytes already read into line.
+ * scanned is the number of bytes already searched for a newline and is updated.
+ * A last line without a newline is only taken at end of file and gets one.
+ * Returns the length of the line or 0 if no whole line has been read.
 **/
-void CheckBGPids(vector* bgPids) {
-    size_t i = 0;
-    int status, rPid;
-    while (i < bgPids->length) {
-        rPid = waitpid(((pid_t*) bgPids->items)[i], &status, WNOHANG);
-        if (rPid > 0) {
-            if (WIFEXITED(status))
-                printf("The process %d exited normally with status: %d.\n", ((pid_t*) bgPids->items)[i], WEXITSTATUS(status));
-            else if (WIFSIGNALED(status))
-                printf("The process %d was terminated with signal: %d.\n", ((pid_t*) bgPids->items)[i], WTERMSIG(status));
-            fflush(stdout);
-            RemoveVector(bgPids, i);
-        } else i++;
+static size_t TakeLine(shell* sh, string* line, size_t* scanned) {
+    char* start = sh->input + sh->inputStart;
+    // Only the bytes read since the last search can hold the newline.
+    char* newline = memchr(start + *scanned, '\n', sh->inputLength - *scanned);
+    size_t length = newline ? newline - start + 1 : sh->inputLength;
+    *scanned = length;
+    if (!newline && !(sh->inputClosed && length > 0)) return 0;
+    SetCStr(line, "");
+    AppendCStrN(line, start, length);
+    if (!newline) AppendCStrN(line, "\n", 1);
+    sh->inputStart += length;
+    sh->inputLength -= length;
+    return line->length;
+}
+
+/**
+ * Copy the next line of the input into line without handling signals, printing
+ *    prompts or doing idle work, for builtins that read the shell's input.
+ * Returns the length of the line or 0 at end of file.
+**/
+size_t ReadLine(shell* sh, string* line) {
+    size_t scanned = 0;
+    while (TakeLine(sh, line, &scanned) == 0) {
+        if (sh->inputClosed) return 0;
+        fflush(stdout);
+        ReadInput(sh);
     }
+    return line->length;
 }
 
-int main(int argc, char* args[]) {
-    SetupSigHandlers(SIG_IGN, HandleSIGTSTP);
-    command c;
-    vector bgPids = ConstructVector(sizeof(pid_t), NULL, NULL);
-    int status;
-    bool running = true;
-    char commandInput[2049];
-    int commandLength = 0;
-    volatile size_t commandCount = 0;
-    volatile bool foregroundOnly = false;
-    volatile pid_t childPid = -1, parentPid = getpid();
-    // Since I was determined not to use globals I have this 129-byte string as a marker for walking up the stack.
-    char FLAG[] = "4u7x!A%D*G-KaPdSgVkYp3s6v8y/B?E(H+MbQeThWmZq4t7w!z$C&F)J@NcRfUjXn2r5u8x/A?D*G-KaPdSgVkYp3s6v9y$B&E)H+MbQeThWmZq4t7w!z%C*F-JaNcRf";
-    while (running) {
-        printf(": ", commandCount);
+/**
+ * Copy the next line of the input into line while handling signals.
+ * Lines have no length limit. Output is flushed before blocking for input.
+ * Returns the length of the line or 0 at end of file.
+**/
+size_t NextLine(shell* sh, string* line) {
+    struct epoll_event events[3];
+    size_t scanned = 0;
+    while (TakeLine(sh, line, &scanned) == 0) {
+        if (sh->inputClosed) return 0;
         fflush(stdout);
-        do {
-            if (fgets(commandInput, sizeof(commandInput), stdin) == NULL)
-                commandInput[0] = 0;
-            commandLength = strlen(commandInput);
-        } while (commandLength <= 0);
-        if (commandInput[0] == '#' || commandInput[0] == '\n') continue;
-
-        ConstructCommand(&c, commandLength, commandInput);
-        PostProcessCommand(&c, parentPid);
-        commandCount++;
-
-        // Built in commands first then everything else.
-        if (strcmp(commandInput, "exit") == 0) {
-            running = false;
-        } else if (strcmp(commandInput, "cd") == 0) {
-            CommandCD(&c);
-        } else if (strcmp(commandInput, "status") == 0) {
-            if (WIFEXITED(status)) printf("The last foreground process exited normally with exit code %d.\n", WEXITSTATUS(status));
-            else printf("The last foreground process was terminated by signal %d.\n", WTERMSIG(status));
-        } else {
-            pid_t tempPid = fork();
-            if (tempPid == 0) {
-                if (c.background && !foregroundOnly) SetupSigHandlers(SIG_IGN, SIG_IGN);
-                else SetupSigHandlers(SIG_DFL, SIG_IGN);
-                char** args = ConstructExecArgs(&c);
-                int inFD = -1, outFD = -1;
-                // IO has failed flush stdout and jump to cleanup/exit.
-                if (PerformIO(&c, &inFD, &outFD)) {
-                    fflush(stdout);
-                    goto exit_child;
-                }
-                execvp(args[0], args);
-                printf("No such file or directory named %s.\n", args[0]);
-exit_child:
-                // Clean up even though we are going to exit anyways.
-                if (inFD >= 0) close(inFD);
-                if (outFD >= 0) close(outFD);
-                free(args);
-                DestroyCommand(&c);
-                DestroyVector(&bgPids);
-                exit(1);
-            } else if (parentPid == getpid()) {
-                // Wait for the process to die if it should be run in the foreground.
-                if (!c.background || foregroundOnly) {
-                    childPid = tempPid;
-                    waitpid(childPid, &status, 0);
-                    if (WIFSIGNALED(status)) {
-                        printf("\nThe foreground process %d was terminated by signal %d.\n", childPid, WTERMSIG(status));
-                        fflush(stdout);
-                    }
-                } else { // If we are running in the background store the pid and print the pid.
-                    PushBackVector(&bgPids, (void*) &tempPid);
-                    printf("The background process is %d.\n", tempPid);
-                    fflush(stdout);
-                }
-            } else {
-                printf("Could not fork. Command %s will not run.\n", c.commandName);
+        FillZygotePool(&sh->zygotes);
+        // Files cannot be watched by epoll so only check signals before blocking on read.
+        int count = epoll_wait(sh->epollFD, events, 3, sh->pollInput ? -1 : 0);
+        bool readable = !sh->pollInput;
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.fd == sh->signalFD || events[i].data.fd == sh->captures.epollFD) HandleIdleSignals(sh);
+            else readable = true;
+        }
+        if (readable) ReadInput(sh);
+    }
+    return line->length;
+}
+
+/**
+ * Block the signals the shell handles and route them to a signalfd
+ *    watched alongside inputFD by an epoll instance.
+ * Prompts are only printed if interactive.
+**/
+void InitShell(shell* sh, launch_backend backend, size_t limit, int inputFD, bool interactive) {
+    sh->pid = getpid();
+    extern char** environ;
+    ConstructVariableStore(&sh->vars, environ);
+    char pidStr[12];
+    sprintf(pidStr, "%d", sh->pid);
+    SetVariable(&sh->vars, "$", 1, pidStr, false);
+    SetStatus(sh, 0);
+    sh->running = true;
+    sh->foregroundOnly = false;
+    sh->pendingToggles = 0;
+    sh->interrupted = false;
+    sh->backend = backend;
+    sh->jobs = ConstructJobTable();
+    ConstructPathCache(&sh->paths);
+    ConstructDirCache(&sh->dirs);
+    ConstructJobQueue(&sh->queue, limit);
+    ConstructParseCache(&sh->parses, PARSE_CACHE_SIZE);
+    InitMemoryManager(&sh->arena);
+    // $HISTFILE is always used, an empty one turning history off, and the default
+    //    history only when the shell is interactive so scripts do not fill it.
+    const char* historyFile = GetVariable(&sh->vars, "HISTFILE", 8);
+    char defaultFile[PATH_MAX];
+    if (historyFile == NULL && interactive) {
+        const char* homeDir = GetVariable(&sh->vars, "HOME", 4);
+        if (homeDir == NULL) homeDir = getpwuid(getuid())->pw_dir;
+        snprintf(defaultFile, sizeof(defaultFile), "%s/.smallsh_history", homeDir);
+        historyFile = defaultFile;
+    }
+    OpenHistory(&sh->history, historyFile);
+    ConstructCaptureTable(&sh->captures);
+    ConstructPlacement(&sh->placement);
+    sh->inputFD = inputFD;
+    sh->interactive = interactive;
+    sh->inputSize = SHELL_READ_SIZE * 2;
+    sh->input = malloc(sh->inputSize);
+    sh->inputStart = sh->inputLength = 0;
+    sh->inputClosed = false;
+
+    // Ignored and blocked signals are still queued for the signalfd while children inherit them as ignored.
+    SetupSigHandlers(SIG_IGN, SIG_IGN);
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTSTP);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    sh->signalFD = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    sh->epollFD = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event = {EPOLLIN, {.fd = sh->signalFD}};
+    epoll_ctl(sh->epollFD, EPOLL_CTL_ADD, sh->signalFD, &event);
+    event.data.fd = sh->captures.epollFD;
+    epoll_ctl(sh->epollFD, EPOLL_CTL_ADD, sh->captures.epollFD, &event);
+    event.data.fd = inputFD;
+    sh->pollInput = epoll_ctl(sh->epollFD, EPOLL_CTL_ADD, inputFD, &event) == 0;
+    // The pool's master is forked last so it inherits the blocked signals.
+    ConstructZygotePool(&sh->zygotes, backend == LAUNCH_ZYGOTE ? ZYGOTE_POOL_SIZE : 0);
+}
+
+/**
+ * Kill the remaining background processes and release the shell's resources.
+**/
+void DestroyShell(shell* sh) {
+    ReapJobs(&sh->jobs);
+    KillJobs(&sh->jobs, SIGTERM);
+    DestroyJobTable(&sh->jobs);
+    DestroyPathCache(&sh->paths);
+    DestroyDirCache(&sh->dirs);
+    DestroyJobQueue(&sh->queue);
+    DestroyParseCache(&sh->parses);
+    DestroyZygotePool(&sh->zygotes);
+    DestroyMemoryManager(&sh->arena);
+    DestroyVariableStore(&sh->vars);
+    CloseHistory(&sh->history);
+    DestroyCaptureTable(&sh->captures);
+    DestroyPlacement(&sh->placement);
+    free(sh->input);
+    if (sh->inputFD != 0) close(sh->inputFD);
+    close(sh->epollFD);
+    close(sh->signalFD);
+}
+
+/**
+ * Run an expanded command: a builtin, a variable assignment or a job.
+ * line is the command's text for the job table.
+**/
+void RunCommand(shell* sh, command* c, string* line) {
+    // An empty command runs nothing, like a blank line.
+    if (c->commandName.length == 0) return;
+    char* equals = memchr(c->commandName.str, '=', c->commandName.length);
+
+    // Built in commands first then everything else.
+    const builtin* b = FindBuiltin(c->commandName.str, c->commandName.length);
+    if (b && CanRunBuiltin(sh, c)) {
+        RunBuiltin(sh, b, c);
+    } else if (!CanForkBuiltins(sh, c)) {
+        SetStatus(sh, W_EXITCODE(2, 0));
+    } else if (equals && c->args.length == 0 && IsVariableName(c->commandName.str, equals - c->commandName.str)) {
+        // NAME=VALUE on its own sets a shell variable.
+        SetVariable(&sh->vars, c->commandName.str, equals - c->commandName.str, equals + 1, false);
+    } else if (c->background && !sh->foregroundOnly && sh->queue.limit > 0 && sh->jobs.backgroundJobs >= sh->queue.limit) {
+        // Every background slot is taken so wait for one to free.
+        printf("The background job is queued as %zu.\n", EnqueueJob(&sh->queue, c, line, sh->queue.priority));
+        fflush(stdout);
+    } else {
+        bool background = c->background && !sh->foregroundOnly;
+        pid_t pids[1 + c->stages.length];
+        size_t started = StartJob(sh, c, line, background, sh->queue.priority, pids);
+        if (!background) {
+            // Wait for every stage to die since it should be run in the foreground.
+            // The last stage's status is the status of the whole pipeline.
+            WaitForeground(sh, pids, started);
+            if (started < 1 + c->stages.length) {
+                // The last stage never ran so report it like a child that failed to exec.
+                SetStatus(sh, W_EXITCODE(1, 0));
+            } else if (WIFSIGNALED(sh->status)) {
+                printf("\nThe foreground process %d was terminated by signal %d.\n", -pids[started - 1], WTERMSIG(sh->status));
                 fflush(stdout);
             }
+        } else if (started > 0) { // If we are running in the background print the last pid.
+            printf("The background process is %d.\n", pids[started - 1]);
+            fflush(stdout);
+        }
+    }
+}
+
+/**
+ * Run a command then the commands of its list in order. A command after "&&"
+ *    only runs if the last command run succeeded and one after "||" if it failed.
+ * With expand each command is expanded right before it runs so it sees
+ *    the variables and "$?" set by the commands before it.
+ * The list stops once a foreground command is killed by SIGINT.
+**/
+void RunCommandList(shell* sh, command* c, string* line, bool expand) {
+    for (size_t i = 0; i <= c->sequence.length; i++) {
+        command* next = i == 0 ? c : ((command*) c->sequence.items) + i - 1;
+        if ((next->join == JOIN_AND && sh->status != 0) || (next->join == JOIN_OR && sh->status == 0)) continue;
+        if (expand) {
+            TraceBegin(TRACE_EXPAND, 0);
+            PostProcessCommand(next, &sh->vars, &sh->dirs);
+            TraceEnd(TRACE_EXPAND, 0);
+        }
+        RunCommand(sh, next, line);
+        if (!sh->running || (WIFSIGNALED(sh->status) && WTERMSIG(sh->status) == SIGINT)) break;
+    }
+}
+
+/**
+ * Parse and run a single line of input.
+**/
+void RunLine(shell* sh, char* commandInput, size_t commandLength) {
+    // Keep the line for the job table since parsing splits it up.
+    string line;
+    ConstructManagedStr(&line, commandInput, &sh->arena);
+    line.str[--line.length] = 0;
+    // Repeated lines skip parsing and expansion and reuse their argv.
+    command parsed;
+    bool expand = false;
+    command* c = GetParsedCommand(&sh->parses, line.str, line.length, sh->vars.generation);
+    if (c == NULL) {
+        size_t generation = sh->vars.generation;
+        TraceBegin(TRACE_PARSE, commandLength);
+        ConstructCommand(&parsed, commandLength, commandInput, &sh->arena);
+        TraceEnd(TRACE_PARSE, commandLength);
+        // A list with variables or wildcards is expanded a command at a time as it runs so it is not cached.
+        expand = parsed.sequence.length > 0 && (memchr(line.str, '$', line.length) != NULL || HasWildcards(line.str, line.length));
+        if (!expand) {
+            TraceBegin(TRACE_EXPAND, 0);
+            PostProcessCommand(&parsed, &sh->vars, &sh->dirs);
+            TraceEnd(TRACE_EXPAND, 0);
+        }
+        c = &parsed;
+        command* cached;
+        // An empty command is not cached so a syntax error is reported every time.
+        if (!expand && parsed.commandName.length > 0 && IsCacheableLine(line.str, line.length) && (cached = PutParsedCommand(&sh->parses, line.str, line.length, &parsed, generation))) {
+            DestroyCommand(&parsed);
+            c = cached;
         }
-        DestroyCommand(&c);
-        CheckBGPids(&bgPids);
-    }
-    // Wait until background processes close.
-    CheckBGPids(&bgPids);
-    for (size_t i = 0; i < bgPids.length; i++)
-        kill(((pid_t*) bgPids.items)[i], SIGTERM);
-    DestroyVector(&bgPids);
-    memset(FLAG, 0, sizeof(FLAG));
+    }
+    RunCommandList(sh, c, &line, expand);
+    if (c == &parsed) DestroyCommand(c);
+    DestroyStr(&line);
+}
+
+/**
+ * Read the rest of the for, while or if block started by commandInput
+ *    then compile and run it. Each line after the first is prompted with "> "
+ *    if the shell is interactive. commandInput is reused for those lines.
+**/
+void RunBlock(shell* sh, string* commandInput) {
+    script s;
+    ConstructScript(&s);
+    script_state state = CompileScriptLine(&s, commandInput->str, commandInput->length);
+    while (state == SCRIPT_INCOMPLETE) {
+        if (sh->interactive) {
+            printf("> ");
+            fflush(stdout);
+        }
+        if (NextLine(sh, commandInput) == 0) {
+            printf("\nThe block was not closed before the end of the input.\n");
+            state = SCRIPT_ERROR;
+        } else {
+            AddHistory(&sh->history, commandInput->str, commandInput->length);
+            state = CompileScriptLine(&s, commandInput->str, commandInput->length);
+        }
+    }
+    if (state == SCRIPT_COMPLETE) RunScript(sh, &s);
+    else SetStatus(sh, W_EXITCODE(2, 0));
+    DestroyScript(&s);
+}
+
+/**
+ * Print how to invoke the shell.
+**/
+void PrintUsage(const char* name) {
+    fprintf(stderr, "Usage: %s [-i] [-l fork|vfork|spawn|zygote] [-j max background jobs] [-t trace file] [script]\n", name);
+}
+
+int main(int argc, char* args[]) {
+    launch_backend backend = LAUNCH_FORK;
+    size_t limit = 0;
+    const char* traceFile = NULL;
+    bool interactive = false;
+    int option;
+    while ((option = getopt(argc, args, "il:j:t:")) != -1) {
+        if (option == 'i') {
+            interactive = true;
+        } else if (option == 'j') {
+            limit = strtoul(optarg, NULL, 10);
+        } else if (option == 't') {
+            traceFile = optarg;
+        } else if (option != 'l' || !ParseLaunchBackend(optarg, &backend)) {
+            PrintUsage(args[0]);
+            return 1;
+        }
+    }
+    // Commands come from the script if one is given, which the commands
+    //    themselves do not inherit, otherwise from stdin.
+    int inputFD = 0;
+    if (optind + 1 < argc) {
+        PrintUsage(args[0]);
+        return 1;
+    } else if (optind < argc && (inputFD = open(args[optind], O_RDONLY | O_CLOEXEC)) < 0) {
+        fprintf(stderr, "Could not open script %s.\n", args[optind]);
+        return 1;
+    }
+    // Without a terminal nobody reads the prompts so batch mode skips them.
+    shell sh;
+    InitShell(&sh, backend, limit, inputFD, interactive || (inputFD == 0 && isatty(0)));
+    sh.traceFile = traceFile;
+    if (traceFile && !StartTrace()) fprintf(stderr, "Could not start tracing.\n");
+    // The line's memory is kept between lines.
+    string commandInput;
+    ConstructStr(&commandInput, "");
+    size_t commandLength;
+    while (sh.running) {
+        if (sh.interactive) {
+            printf(": ");
+            fflush(stdout);
+        }
+        TraceBegin(TRACE_READ, 0);
+        commandLength = NextLine(&sh, &commandInput);
+        TraceEnd(TRACE_READ, commandLength);
+        if (commandLength == 0) break;
+        if (commandInput.str[0] == '#' || commandInput.str[0] == '\n') continue;
+        // A history reference is replaced by the entry before the line is stored.
+        if (!ExpandHistory(&sh.history, &commandInput)) continue;
+        AddHistory(&sh.history, commandInput.str, commandInput.length);
+        if (IsScriptStart(commandInput.str, commandInput.length)) RunBlock(&sh, &commandInput);
+        else RunLine(&sh, commandInput.str, commandInput.length);
+        ResetMemoryManager(&sh.arena);
+        HandleSignals(&sh);
+    }
+    DestroyStr(&commandInput);
+    DestroyShell(&sh);
+    if (GTrace && sh.traceFile && !DumpTrace(sh.traceFile))
+        fprintf(stderr, "Could not write the trace to %s.\n", sh.traceFile);
+    StopTrace();
     return 0;
 }
@@ -0,0 +1,173 @@
+#include "map.h"
+
+#include <memory.h>
+
+/**
+ * Hashes a block of bytes with 64 bit FNV-1a.
+ * @param bytes The start of the block.
+ * @param length The number of bytes to hash.
+ * @return The hash of the block.
+**/
+size_t HashBytes(const void* bytes, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= ((const uint8_t*) bytes)[i];
+        hash *= 1099511628211ULL;
+    }
+    return (size_t) hash;
+}
+
+/**
+ * Creates a map struct with 16 slots.
+ * @param typeSize Is the size of the items the map contains.
+ * @param hash Is the function which hashes the key of an item.
+ * @param equals Is the function which compares the keys of two items.
+ * @param copyConstructor Is an optional function for moving an item.
+ * @param destructor Is an optional function for performing cleanup
+ *   on an item.
+ * @return The constructed map.
+**/
+map ConstructMap(size_t typeSize, size_t (*hash)(const void*), bool (*equals)(const void*, const void*), void (*copyConstructor)(void*, void*), void (*destructor)(void*)) {
+    map m = {0, 16, typeSize, malloc(typeSize * 16), calloc(16, sizeof(bool)), hash, equals, copyConstructor, destructor};
+    return m;
+}
+
+/**
+ * Moves an item into a slot with the copy constructor or memcpy.
+**/
+static void MoveItem(map* map, size_t slot, void* valuePtr) {
+    uint8_t* item = ((uint8_t*) map->items) + slot * map->typeSize;
+    if (map->copyConstructor) map->copyConstructor(item, valuePtr);
+    else memcpy(item, valuePtr, map->typeSize);
+    map->used[slot] = true;
+}
+
+/**
+ * Finds the slot holding the probe's key or the empty slot where it belongs.
+**/
+static size_t FindSlot(map* map, const void* probe) {
+    size_t mask = map->size - 1;
+    size_t slot = map->hash(probe) & mask;
+    while (map->used[slot] && !map->equals(((uint8_t*) map->items) + slot * map->typeSize, probe))
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+/**
+ * Doubles the number of slots and moves every item to its new slot.
+ * @return If the map was successfully grown.
+**/
+static bool GrowMap(map* map) {
+    struct map old = *map;
+    map->size *= 2;
+    map->items = malloc(map->typeSize * map->size);
+    map->used = calloc(map->size, sizeof(bool));
+    if (map->items == NULL || map->used == NULL) {
+        free(map->items);
+        free(map->used);
+        *map = old;
+        return false;
+    }
+    for (size_t i = 0; i < old.size; i++) {
+        if (old.used[i]) {
+            void* item = ((uint8_t*) old.items) + i * old.typeSize;
+            MoveItem(map, FindSlot(map, item), item);
+        }
+    }
+    free(old.items);
+    free(old.used);
+    return true;
+}
+
+/**
+ * Finds the item with the same key as the probe.
+ * @param map The map to search.
+ * @param probe An item with its key members set.
+ * @return The stored item or NULL if there is none.
+**/
+void* GetMap(map* map, const void* probe) {
+    size_t slot = FindSlot(map, probe);
+    return map->used[slot] ? ((uint8_t*) map->items) + slot * map->typeSize : NULL;
+}
+
+/**
+ * Stores a value in the map replacing any item with the same key.
+ * @param map The map to store the value in.
+ * @param valuePtr The value to store.
+ * @return The stored item or NULL if the map could not grow.
+**/
+void* PutMap(map* map, void* valuePtr) {
+    if ((map->length + 1) * 4 > map->size * 3 && !GrowMap(map)) return NULL;
+    size_t slot = FindSlot(map, valuePtr);
+    if (map->used[slot]) {
+        if (map->destructor) map->destructor(((uint8_t*) map->items) + slot * map->typeSize);
+    } else {
+        map->length++;
+    }
+    MoveItem(map, slot, valuePtr);
+    return ((uint8_t*) map->items) + slot * map->typeSize;
+}
+
+/**
+ * Removes the item with the same key as the probe.
+ * The items after it in its probe run are shifted back into the hole.
+ * Pointers to items are invalidated and iteration must not be in progress.
+ * @param map The map to remove from.
+ * @param probe An item with its key members set.
+ * @return If an item was removed.
+**/
+bool RemoveMap(map* map, const void* probe) {
+    size_t mask = map->size - 1;
+    size_t hole = FindSlot(map, probe);
+    if (!map->used[hole]) return false;
+    if (map->destructor) map->destructor(((uint8_t*) map->items) + hole * map->typeSize);
+    map->used[hole] = false;
+    map->length--;
+    for (size_t slot = (hole + 1) & mask; map->used[slot]; slot = (slot + 1) & mask) {
+        void* item = ((uint8_t*) map->items) + slot * map->typeSize;
+        size_t home = map->hash(item) & mask;
+        // Move the item back only if its home slot is not between the hole and itself.
+        if ((slot > hole && (home <= hole || home > slot)) || (slot < hole && home <= hole && home > slot)) {
+            MoveItem(map, hole, item);
+            map->used[slot] = false;
+            hole = slot;
+        }
+    }
+    return true;
+}
+
+/**
+ * Iterates over the items of the map.
+ * @param map The map to iterate.
+ * @param index Is the position of the iteration, start it at 0.
+ * @return The next item or NULL when every item has been visited.
+**/
+void* NextMap(map* map, size_t* index) {
+    for (; *index < map->size; (*index)++) {
+        if (map->used[*index]) return ((uint8_t*) map->items) + (*index)++ * map->typeSize;
+    }
+    return NULL;
+}
+
+/**
+ * Destroys all items stored and sets length to 0.
+ * @param map The map to clear.
+**/
+void ClearMap(map* map) {
+    for (size_t i = 0; i < map->size; i++) {
+        if (map->used[i] && map->destructor)
+            map->destructor(((uint8_t*) map->items) + i * map->typeSize);
+        map->used[i] = false;
+    }
+    map->length = 0;
+}
+
+/**
+ * Cleans up map heap allocation.
+ * @param map The map to destroy.
+**/
+void DestroyMap(map* map) {
+    ClearMap(map);
+    free(map->items);
+    free(map->used);
+}
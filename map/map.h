@@ -0,0 +1,49 @@
+#ifndef map_h
+#define map_h
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**=================================================================|
+ * An open-addressed hash table using linear probing.               |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * The key is stored inside each item. Lookups take a probe item    |
+ * which only needs its key members set. Removal shifts the rest    |
+ * of the probe run back so no tombstones are left behind and       |
+ * every operation stays O(1) on average.                           |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * size_t length The number of items currently stored.              |
+ * size_t size The number of slots, always a power of 2.            |
+ * size_t typeSize The size of each item.                           |
+ * void* items The pointer to the start of the slots.               |
+ * bool* used Which slots hold an item.                             |
+ * size_t (*hash)(const void*) Hashes the key of an item.           |
+ * bool (*equals)(const void*, const void*) If the keys of two      |
+ *      items are equal.                                            |
+ * void (*copyConstructor)(void*, void*) An optional parameter      |
+ *      used to move items between slots. When NULL memcpy is used. |
+ * void (*destructor)(void*) An optional parameter used to clean    |
+ *      up an item when it is removed or replaced.                  |
+ * =================================================================|
+**/
+typedef struct map {
+    size_t length, size, typeSize;
+    void* items;
+    bool* used;
+    size_t (*hash)(const void*);
+    bool (*equals)(const void*, const void*);
+    void (*copyConstructor)(void*, void*);
+    void (*destructor)(void*);
+} map;
+
+size_t HashBytes(const void* bytes, size_t length);
+map ConstructMap(size_t typeSize, size_t (*hash)(const void*), bool (*equals)(const void*, const void*), void (*copyConstructor)(void*, void*), void (*destructor)(void*));
+void* GetMap(map* map, const void* probe);
+void* PutMap(map* map, void* valuePtr);
+bool RemoveMap(map* map, const void* probe);
+void* NextMap(map* map, size_t* index);
+void ClearMap(map* map);
+void DestroyMap(map* map);
+#endif
\ No newline at end of file
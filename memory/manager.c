@@ -0,0 +1,198 @@
+#include "manager.h"
+
+#include <memory.h>
+
+#define ALIGNMENT 16
+// Every allocation is preceded by a header holding its size.
+#define HEADER_SIZE ALIGNMENT
+#define ALIGN(size) (((size) + ALIGNMENT - 1) & ~(size_t) (ALIGNMENT - 1))
+#define ALLOC_SIZE(ptr) (*(size_t*) ((uint8_t*) (ptr) - HEADER_SIZE))
+
+static memory_manager GManager;
+
+/**
+ * Initializes the global memory manager.
+**/
+void GInitMemoryManager() {
+    InitMemoryManager(&GManager);
+}
+
+/**
+ * Alloc using the global memory manager.
+**/
+void* GAlloc(size_t size) {
+    return Alloc(&GManager, size);
+}
+
+/**
+ * Realloc using the global memory manager.
+**/
+void* GRealloc(void* ptr, size_t newSize) {
+    return Realloc(&GManager, ptr, newSize);
+}
+
+/**
+ * Calloc using the global memory manager.
+**/
+void* GCalloc(size_t count, size_t size) {
+    return Calloc(&GManager, count, size);
+}
+
+/**
+ * Recalloc using the global memory manager.
+**/
+void* GRecalloc(void* ptr, size_t count, size_t size) {
+    return Recalloc(&GManager, ptr, count, size);
+}
+
+/**
+ * Free using the global memory manager.
+**/
+void GFree(void* ptr) {
+    Free(&GManager, ptr);
+}
+
+/**
+ * Reset the global memory manager.
+**/
+void GResetMemoryManager() {
+    ResetMemoryManager(&GManager);
+}
+
+/**
+ * Destroy the global memory manager.
+**/
+void GDestroyMemoryManager() {
+    DestroyMemoryManager(&GManager);
+}
+
+/**
+ * Initializes a memory manager without any pages.
+ * @param manager The manager to initialize.
+**/
+void InitMemoryManager(memory_manager* manager) {
+    manager->pages = NULL;
+    manager->current = NULL;
+    manager->last = NULL;
+}
+
+/**
+ * Allocates a block of memory from the current page. Moves on to the
+ * next page if it does not fit, creating one if the next page is too small.
+ * @param manager The manager to allocate from or NULL to use malloc.
+ * @param size The size of the block.
+ * @return The block of memory or NULL if a page could not be allocated.
+**/
+void* Alloc(memory_manager* manager, size_t size) {
+    if (manager == NULL) return malloc(size);
+    size_t needed = HEADER_SIZE + ALIGN(size);
+    memory_page* page = manager->current;
+    if (page == NULL || page->size - page->used < needed) {
+        if (page != NULL && page->next != NULL && page->next->size >= needed) {
+            page = page->next;
+        } else {
+            size_t pageSize = needed > G_MemoryManager_PG_SIZE ? needed : G_MemoryManager_PG_SIZE;
+            memory_page* newPage = malloc(sizeof(memory_page) + pageSize);
+            if (newPage == NULL) return NULL;
+            newPage->size = pageSize;
+            if (page == NULL) {
+                newPage->next = manager->pages;
+                manager->pages = newPage;
+            } else {
+                newPage->next = page->next;
+                page->next = newPage;
+            }
+            page = newPage;
+        }
+        page->used = 0;
+        manager->current = page;
+    }
+    uint8_t* block = page->data + page->used + HEADER_SIZE;
+    page->used += needed;
+    ALLOC_SIZE(block) = ALIGN(size);
+    manager->last = block;
+    return block;
+}
+
+/**
+ * Resizes a block of memory. The most recent allocation grows in place
+ * when the page has room, otherwise a new block is allocated and copied.
+ * @param manager The manager the block came from or NULL to use realloc.
+ * @param ptr The block to resize or NULL to allocate a new block.
+ * @param newSize The new size of the block.
+ * @return The resized block or NULL if it could not be resized.
+**/
+void* Realloc(memory_manager* manager, void* ptr, size_t newSize) {
+    if (manager == NULL) return realloc(ptr, newSize);
+    if (ptr == NULL) return Alloc(manager, newSize);
+    size_t oldSize = ALLOC_SIZE(ptr);
+    if (ALIGN(newSize) <= oldSize) return ptr;
+    memory_page* page = manager->current;
+    if (ptr == manager->last && page->size - page->used >= ALIGN(newSize) - oldSize) {
+        page->used += ALIGN(newSize) - oldSize;
+        ALLOC_SIZE(ptr) = ALIGN(newSize);
+        return ptr;
+    }
+    void* block = Alloc(manager, newSize);
+    if (block == NULL) return NULL;
+    memcpy(block, ptr, oldSize);
+    return block;
+}
+
+/**
+ * Allocates a zeroed block of memory for count items of size.
+**/
+void* Calloc(memory_manager* manager, size_t count, size_t size) {
+    if (manager == NULL) return calloc(count, size);
+    void* block = Alloc(manager, count * size);
+    if (block != NULL) memset(block, 0, count * size);
+    return block;
+}
+
+/**
+ * Resizes a block of memory to count items of size zeroing any new bytes.
+**/
+void* Recalloc(memory_manager* manager, void* ptr, size_t count, size_t size) {
+    size_t oldSize = ptr == NULL || manager == NULL ? 0 : ALLOC_SIZE(ptr);
+    void* block = Realloc(manager, ptr, count * size);
+    if (block != NULL && count * size > oldSize) memset((uint8_t*) block + oldSize, 0, count * size - oldSize);
+    return block;
+}
+
+/**
+ * Releases a block of memory. Only the most recent allocation of a
+ * manager is actually returned to its page, the rest wait for a reset.
+ * @param manager The manager the block came from or NULL to use free.
+ * @param ptr The block to release.
+**/
+void Free(memory_manager* manager, void* ptr) {
+    if (manager == NULL) {
+        free(ptr);
+    } else if (ptr != NULL && ptr == manager->last) {
+        manager->current->used -= HEADER_SIZE + ALLOC_SIZE(ptr);
+        manager->last = NULL;
+    }
+}
+
+/**
+ * Releases every allocation at once while keeping the pages.
+ * @param manager The manager to reset.
+**/
+void ResetMemoryManager(memory_manager* manager) {
+    manager->current = manager->pages;
+    if (manager->current != NULL) manager->current->used = 0;
+    manager->last = NULL;
+}
+
+/**
+ * Frees every page of the manager.
+ * @param manager The manager to destroy.
+**/
+void DestroyMemoryManager(memory_manager* manager) {
+    while (manager->pages != NULL) {
+        memory_page* next = manager->pages->next;
+        free(manager->pages);
+        manager->pages = next;
+    }
+    InitMemoryManager(manager);
+}
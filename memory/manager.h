@@ -0,0 +1,68 @@
+#ifndef manager_h
+#define manager_h
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifndef G_MemoryManager_PG_SIZE
+#define G_MemoryManager_PG_SIZE 4096
+#endif
+
+/**=================================================================|
+ * A page of memory handed out by a memory_manager.                 |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * memory_page* next The next page, reused after a reset.           |
+ * size_t size The number of bytes in data.                         |
+ * size_t used The number of bytes of data handed out.              |
+ * uint8_t data[] The memory handed out, aligned to 16 bytes like   |
+ *      every block carved from it.                                 |
+ * =================================================================|
+**/
+typedef struct memory_page {
+    struct memory_page* next;
+    size_t size, used;
+    _Alignas(16) uint8_t data[];
+} memory_page;
+
+/**=================================================================|
+ * A page-based bump allocator.                                     |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * Allocations are carved off the current page and are only         |
+ * released all at once by ResetMemoryManager, which is O(1) and    |
+ * keeps the pages for the next round so a steady workload never    |
+ * calls malloc. Each allocation is preceded by its size so         |
+ * Realloc can copy it, and the most recent allocation is grown or  |
+ * freed in place. Passing a NULL manager to any function uses the  |
+ * C allocator instead, which lets structs hold an optional manager.|
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * memory_page* pages The first page.                               |
+ * memory_page* current The page allocations are carved from.       |
+ * void* last The most recent allocation.                           |
+ * =================================================================|
+**/
+typedef struct memory_manager {
+    memory_page* pages;
+    memory_page* current;
+    void* last;
+} memory_manager;
+
+void GInitMemoryManager();
+void* GAlloc(size_t size);
+void* GRealloc(void* ptr, size_t newSize);
+void* GCalloc(size_t count, size_t size);
+void* GRecalloc(void* ptr, size_t count, size_t size);
+void GFree(void* ptr);
+void GResetMemoryManager();
+void GDestroyMemoryManager();
+
+void InitMemoryManager(memory_manager* manager);
+void* Alloc(memory_manager* manager, size_t size);
+void* Realloc(memory_manager* manager, void* ptr, size_t newSize);
+void* Calloc(memory_manager* manager, size_t count, size_t size);
+void* Recalloc(memory_manager* manager, void* ptr, size_t count, size_t size);
+void Free(memory_manager* manager, void* ptr);
+void ResetMemoryManager(memory_manager* manager);
+void DestroyMemoryManager(memory_manager* manager);
+#endif
\ No newline at end of file
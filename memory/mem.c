@@ -7,6 +7,7 @@
  * Uses realloc to attempt to reallocate the memory and if that fails
  * it instead searches for a new block of memory with malloc.
  * If malloc fails it maintains the old block of memory and returns NULL.
+ * @param manager Is the memory manager the block came from or NULL for the heap.
  * @param ptr Is a pointer which points to the start of the old memory block.
  * @param typeSize Is the block size for this pointer.
  * @param newCount Is the new count of the blocks of memory length of typeSize.
@@ -14,9 +15,9 @@
  * @param copyConstructor Is an optional function to block a block of memory to the new block.
  * @return The new block of memory or NULL if the block could not be reallocated.
 **/
-void* ReallocProper(void** ptr, size_t typeSize, size_t newCount, size_t oldCount, void (*copyConstructor)(void*, void*)) {
+void* ReallocProper(memory_manager* manager, void** ptr, size_t typeSize, size_t newCount, size_t oldCount, void (*copyConstructor)(void*, void*)) {
     size_t newSize = typeSize * newCount, oldSize = typeSize * oldCount;
-    void* temp = realloc(*ptr, newSize);
+    void* temp = Realloc(manager, *ptr, newSize);
     if (temp == NULL) return NULL;
     if (temp != *ptr && copyConstructor) {
         for (size_t offset = 0; offset < oldSize; offset += typeSize) {
@@ -30,15 +31,18 @@ void* ReallocProper(void** ptr, size_t typeSize, size_t newCount, size_t oldCoun
 /**
  * Attempts to shrink the memory block using realloc, if realloc fails malloc is used.
  * If malloc fails it maintains the old block of memory and returns NULL.
+ * @param manager Is the memory manager the block came from or NULL for the heap.
  * @param ptr Is a pointer which points to the start of the old memory block.
  * @param typeSize Is the block size for this pointer.
  * @param newCount Is the count of how many typeSize blocks there are.
  * @param copyConstructor Is an optional function to block a block of memory to the new block.
  * @return The new block of memory or NULL if the block could not be reallocated.
 **/
-void* ShrinkAlloc(void** ptr, size_t typeSize, size_t newCount, void (*copyConstructor)(void*, void*)) {
+void* ShrinkAlloc(memory_manager* manager, void** ptr, size_t typeSize, size_t newCount, void (*copyConstructor)(void*, void*)) {
     void* temp = *ptr;
     size_t newSize = typeSize * newCount;
+    // A manager never moves a block to shrink it.
+    if (manager != NULL) return *ptr;
     if ((*ptr = realloc(*ptr, newSize)) == NULL) {
         *ptr = malloc(newSize);
         if (*ptr == NULL) {
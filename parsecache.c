@@ -0,0 +1,146 @@
+#define _GNU_SOURCE
+#include "parsecache.h"
+#include "launch.h"
+
+#include <string.h>
+
+/**
+ * Hash an entry pointer by its stored hash.
+**/
+static size_t HashEntry(const void* e) {
+    return (*(parse_entry* const*) e)->hash;
+}
+
+/**
+ * Compare two entry pointers by their lines.
+**/
+static bool EqualsEntry(const void* e1, const void* e2) {
+    const parse_entry* entry1 = *(parse_entry* const*) e1;
+    const parse_entry* entry2 = *(parse_entry* const*) e2;
+    return entry1->hash == entry2->hash && entry1->line.length == entry2->line.length
+        && memcmp(entry1->line.str, entry2->line.str, entry1->line.length) == 0;
+}
+
+/**
+ * Initialize an empty cache.
+ * @param cache The cache to initialize.
+ * @param capacity The max number of lines kept.
+**/
+void ConstructParseCache(parse_cache* cache, size_t capacity) {
+    cache->entries = ConstructMap(sizeof(parse_entry*), HashEntry, EqualsEntry, NULL, NULL);
+    cache->newest = cache->oldest = NULL;
+    cache->capacity = capacity;
+}
+
+/**
+ * If a line can be cached. "$?" changes after every command so lines using it are not,
+ *    nor are lines with wildcards since what they match changes with the directories.
+**/
+bool IsCacheableLine(const char* line, size_t length) {
+    return memmem(line, length, "$?", 2) == NULL && !HasWildcards(line, length);
+}
+
+/**
+ * Take an entry out of the LRU list.
+**/
+static void Unlink(parse_cache* cache, parse_entry* entry) {
+    if (entry->newer) entry->newer->older = entry->older;
+    else cache->newest = entry->older;
+    if (entry->older) entry->older->newer = entry->newer;
+    else cache->oldest = entry->newer;
+}
+
+/**
+ * Put an entry at the newest end of the LRU list.
+**/
+static void LinkNewest(parse_cache* cache, parse_entry* entry) {
+    entry->newer = NULL;
+    entry->older = cache->newest;
+    if (cache->newest) cache->newest->newer = entry;
+    else cache->oldest = entry;
+    cache->newest = entry;
+}
+
+/**
+ * Remove an entry from the cache and free it.
+**/
+static void Evict(parse_cache* cache, parse_entry* entry) {
+    Unlink(cache, entry);
+    RemoveMap(&cache->entries, &entry);
+    DestroyCommand(&entry->c);
+    DestroyStr(&entry->line);
+    free(entry);
+}
+
+/**
+ * Find the command a line was parsed into.
+ * @param cache The cache to look in.
+ * @param line The raw line, it does not need to be null-terminated.
+ * @param length The length of the line.
+ * @param generation The current variable store generation.
+ * @return The command which belongs to the cache or NULL if the line is not
+ *    cached or its variables may have changed since it was expanded.
+**/
+command* GetParsedCommand(parse_cache* cache, const char* line, size_t length, size_t generation) {
+    parse_entry probe;
+    parse_entry* key = &probe;
+    ConstructStrView(&probe.line, (char*) line, length, NULL);
+    probe.hash = HashBytes(line, length);
+    parse_entry** found = GetMap(&cache->entries, &key);
+    if (found == NULL) return NULL;
+    parse_entry* entry = *found;
+    if (entry->expands && entry->generation != generation) {
+        Evict(cache, entry);
+        return NULL;
+    }
+    Unlink(cache, entry);
+    LinkNewest(cache, entry);
+    return &entry->c;
+}
+
+/**
+ * Cache a copy of a parsed and expanded command, evicting the least recently used line if full.
+ * @param cache The cache to add to.
+ * @param line The raw line the command was parsed from.
+ * @param length The length of the line.
+ * @param c The expanded command, it is copied so it may live in an arena.
+ * @param generation The variable store generation the command was expanded in.
+ * @return The cached copy of the command with command::execArgs built for
+ *    every stage and command of its list, or NULL if it could not be cached.
+**/
+command* PutParsedCommand(parse_cache* cache, const char* line, size_t length, command* c, size_t generation) {
+    if (cache->capacity == 0) return NULL;
+    if (cache->entries.length >= cache->capacity) Evict(cache, cache->oldest);
+    parse_entry* entry = malloc(sizeof(parse_entry));
+    ConstructStr(&entry->line, NULL);
+    AppendCStrN(&entry->line, line, length);
+    entry->hash = HashBytes(line, length);
+    entry->expands = memchr(line, '$', length) != NULL;
+    entry->generation = generation;
+    DeepCopyCommand(&entry->c, c, NULL);
+    // The copy is complete so the strings will not move anymore.
+    BuildExecArgs(&entry->c);
+    if (PutMap(&cache->entries, &entry) == NULL) {
+        DestroyCommand(&entry->c);
+        DestroyStr(&entry->line);
+        free(entry);
+        return NULL;
+    }
+    LinkNewest(cache, entry);
+    return &entry->c;
+}
+
+/**
+ * Drop every line from the cache.
+**/
+void ClearParseCache(parse_cache* cache) {
+    while (cache->oldest) Evict(cache, cache->oldest);
+}
+
+/**
+ * Cleans up the cache.
+**/
+void DestroyParseCache(parse_cache* cache) {
+    ClearParseCache(cache);
+    DestroyMap(&cache->entries);
+}
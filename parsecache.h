@@ -0,0 +1,63 @@
+#ifndef parsecache_h
+#define parsecache_h
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "command.h"
+#include "map/map.h"
+#include "string/str.h"
+
+// The number of lines kept by the shell's parse cache.
+#define PARSE_CACHE_SIZE 128
+
+/**=================================================================|
+ * A parsed and expanded line.                                      |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * string line The raw line, the key of the cache.                  |
+ * size_t hash The hash of line.                                    |
+ * bool expands If the line has variables so it is only valid       |
+ *      while the variable store has the same generation.           |
+ * size_t generation The variable store generation it expanded in.  |
+ * command c The expanded command with command::execArgs built,     |
+ *      allocated on the heap.                                      |
+ * parse_entry* newer, older The neighbours in the LRU list.        |
+ * =================================================================|
+**/
+typedef struct parse_entry {
+    string line;
+    size_t hash;
+    bool expands;
+    size_t generation;
+    command c;
+    struct parse_entry* newer;
+    struct parse_entry* older;
+} parse_entry;
+
+/**=================================================================|
+ * A bounded LRU cache of parsed lines.                             |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * The map holds pointers so the entries and their commands never   |
+ * move and the argv of every stage stays valid.                    |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * map entries The parse_entry pointers keyed by parse_entry::line. |
+ * parse_entry* newest, oldest The ends of the LRU list.            |
+ * size_t capacity The max number of entries.                       |
+ * =================================================================|
+**/
+typedef struct parse_cache {
+    map entries;
+    parse_entry* newest;
+    parse_entry* oldest;
+    size_t capacity;
+} parse_cache;
+
+void ConstructParseCache(parse_cache* cache, size_t capacity);
+bool IsCacheableLine(const char* line, size_t length);
+command* GetParsedCommand(parse_cache* cache, const char* line, size_t length, size_t generation);
+command* PutParsedCommand(parse_cache* cache, const char* line, size_t length, command* c, size_t generation);
+void ClearParseCache(parse_cache* cache);
+void DestroyParseCache(parse_cache* cache);
+#endif
\ No newline at end of file
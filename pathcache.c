@@ -0,0 +1,142 @@
+#include "pathcache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * Hash an entry by its name.
+**/
+static size_t HashEntry(const void* e) {
+    const path_entry* entry = e;
+    return HashBytes(entry->name.str, entry->name.length);
+}
+
+/**
+ * Compare two entries by their names.
+**/
+static bool EqualsEntry(const void* e1, const void* e2) {
+    const path_entry* entry1 = e1;
+    const path_entry* entry2 = e2;
+    return entry1->name.length == entry2->name.length && memcmp(entry1->name.str, entry2->name.str, entry1->name.length) == 0;
+}
+
+/**
+ * Moves the second entry into the first entry.
+**/
+static void CopyConstructEntry(void* e1, void* e2) {
+    path_entry* entry = e1;
+    *entry = *(path_entry*) e2;
+    CopyConstructStr(&entry->name, &entry->name);
+    CopyConstructStr(&entry->path, &entry->path);
+}
+
+/**
+ * Destroy the entry's strings.
+**/
+static void DestroyEntry(void* e) {
+    DestroyStr(&((path_entry*) e)->name);
+    DestroyStr(&((path_entry*) e)->path);
+}
+
+/**
+ * Initialize an empty cache.
+**/
+void ConstructPathCache(path_cache* cache) {
+    cache->entries = ConstructMap(sizeof(path_entry), HashEntry, EqualsEntry, CopyConstructEntry, DestroyEntry);
+    ConstructStr(&cache->searchPath, "");
+}
+
+/**
+ * Search each directory of searchPath for an executable regular file named name.
+ * @return If the file was found, in which case path holds it.
+**/
+static bool SearchPath(const char* name, const char* searchPath, string* path) {
+    size_t nameLength = strlen(name);
+    const char* dir = searchPath;
+    while (true) {
+        const char* end = strchr(dir, ':');
+        size_t dirLength = end ? (size_t) (end - dir) : strlen(dir);
+        SetCStr(path, "");
+        // An empty PATH entry means the current directory.
+        if (dirLength == 0) AppendCStrN(path, ".", 1);
+        else AppendCStrN(path, dir, dirLength);
+        AppendCStrN(path, "/", 1);
+        AppendCStrN(path, name, nameLength);
+        struct stat info;
+        if (stat(path->str, &info) == 0 && S_ISREG(info.st_mode) && access(path->str, X_OK) == 0) return true;
+        if (end == NULL) return false;
+        dir = end + 1;
+    }
+}
+
+/**
+ * Find the absolute path of a command, searching searchPath on the first use.
+ * Names containing a '/' are not looked up.
+ * @param cache The cache to look in.
+ * @param name The command name.
+ * @param searchPath The current PATH, the cache is cleared if it changed.
+ * @return The path of the command or NULL if it is not in PATH.
+**/
+const char* LookupPath(path_cache* cache, const char* name, const char* searchPath) {
+    if (strchr(name, '/') != NULL) return NULL;
+    if (strcmp(cache->searchPath.str, searchPath) != 0) {
+        ClearMap(&cache->entries);
+        SetCStr(&cache->searchPath, searchPath);
+    }
+    path_entry probe;
+    ConstructStrView(&probe.name, (char*) name, strlen(name), NULL);
+    path_entry* entry = GetMap(&cache->entries, &probe);
+    if (entry == NULL) {
+        path_entry e;
+        ConstructStr(&e.name, name);
+        ConstructStr(&e.path, NULL);
+        e.hits = 0;
+        if (!SearchPath(name, searchPath, &e.path) || (entry = PutMap(&cache->entries, &e)) == NULL) {
+            DestroyEntry(&e);
+            return NULL;
+        }
+    }
+    entry->hits++;
+    return entry->path.str;
+}
+
+/**
+ * Drop a command from the cache, used when its cached path failed to exec.
+**/
+void ForgetPath(path_cache* cache, const char* name) {
+    path_entry probe;
+    ConstructStrView(&probe.name, (char*) name, strlen(name), NULL);
+    RemoveMap(&cache->entries, &probe);
+}
+
+/**
+ * Drop every command from the cache.
+**/
+void ClearPathCache(path_cache* cache) {
+    ClearMap(&cache->entries);
+}
+
+/**
+ * Print the number of uses and path of every cached command.
+**/
+void PrintPathCache(path_cache* cache) {
+    if (cache->entries.length == 0) {
+        printf("The command cache is empty.\n");
+        return;
+    }
+    printf("hits\tcommand\n");
+    size_t index = 0;
+    path_entry* entry;
+    while ((entry = NextMap(&cache->entries, &index)))
+        printf("%4zu\t%s\n", entry->hits, entry->path.str);
+}
+
+/**
+ * Cleans up the cache.
+**/
+void DestroyPathCache(path_cache* cache) {
+    DestroyMap(&cache->entries);
+    DestroyStr(&cache->searchPath);
+}
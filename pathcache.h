@@ -0,0 +1,44 @@
+#ifndef pathcache_h
+#define pathcache_h
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "map/map.h"
+#include "string/str.h"
+
+/**=================================================================|
+ * Where a command was found in PATH.                               |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * string name The command name, the key of the cache.              |
+ * string path The absolute path of the command.                    |
+ * size_t hits The number of times the path was used.               |
+ * =================================================================|
+**/
+typedef struct path_entry {
+    string name;
+    string path;
+    size_t hits;
+} path_entry;
+
+/**=================================================================|
+ * A cache of command locations so exec does not search PATH.       |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * map entries The path_entry structs keyed by path_entry::name.    |
+ * string searchPath The PATH the entries were found in. The cache  |
+ *      is cleared when a lookup is made with a different PATH.     |
+ * =================================================================|
+**/
+typedef struct path_cache {
+    map entries;
+    string searchPath;
+} path_cache;
+
+void ConstructPathCache(path_cache* cache);
+const char* LookupPath(path_cache* cache, const char* name, const char* searchPath);
+void ForgetPath(path_cache* cache, const char* name);
+void ClearPathCache(path_cache* cache);
+void PrintPathCache(path_cache* cache);
+void DestroyPathCache(path_cache* cache);
+#endif
\ No newline at end of file
@@ -0,0 +1,250 @@
+#define _GNU_SOURCE
+#include "placement.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define MASK_BITS (8 * sizeof(unsigned long))
+// MPOL_BIND from <numaif.h>, which comes with libnuma.
+#define MPOL_BIND 2
+
+/**
+ * Add a CPU to a set.
+**/
+static void AddCPU(cpu_mask* cpus, size_t cpu) {
+    cpus->bits[cpu / MASK_BITS] |= 1UL << (cpu % MASK_BITS);
+}
+
+/**
+ * Check if a CPU is in a set.
+**/
+static bool HasCPU(const cpu_mask* cpus, size_t cpu) {
+    return cpu < PLACEMENT_MAX_CPUS && (cpus->bits[cpu / MASK_BITS] >> (cpu % MASK_BITS)) & 1;
+}
+
+/**
+ * Parse a CPU list like "0-3,8,10-11", the format of sysfs and taskset -c.
+ * @param list The list, it may end with a newline.
+ * @param cpus Set to the CPUs of the list.
+ * @return false if the list is empty or not a CPU list.
+**/
+bool ParseCPUList(const char* list, cpu_mask* cpus) {
+    memset(cpus, 0, sizeof(*cpus));
+    bool any = false;
+    const char* c = list;
+    while (*c && *c != '\n') {
+        if (!isdigit(*c)) return false;
+        char* end;
+        unsigned long first = strtoul(c, &end, 10), last = first;
+        if (*end == '-') {
+            if (!isdigit(end[1])) return false;
+            last = strtoul(end + 1, &end, 10);
+        }
+        if (first > last || last >= PLACEMENT_MAX_CPUS) return false;
+        for (unsigned long cpu = first; cpu <= last; cpu++) AddCPU(cpus, cpu);
+        any = true;
+        c = end;
+        if (*c == ',') c++;
+        else if (*c && *c != '\n') return false;
+    }
+    return any;
+}
+
+/**
+ * Write a set of CPUs as a CPU list with runs of CPUs joined by '-'.
+ * A list that does not fit in size is cut off after the last run that fits.
+ * @return The length of the list.
+**/
+size_t FormatCPUList(const cpu_mask* cpus, char* list, size_t size) {
+    size_t length = 0;
+    list[0] = 0;
+    for (size_t cpu = 0; cpu < PLACEMENT_MAX_CPUS; cpu++) {
+        if (!HasCPU(cpus, cpu)) continue;
+        size_t last = cpu;
+        while (HasCPU(cpus, last + 1)) last++;
+        int written = last == cpu
+            ? snprintf(list + length, size - length, "%s%zu", length ? "," : "", cpu)
+            : snprintf(list + length, size - length, "%s%zu-%zu", length ? "," : "", cpu, last);
+        if (written < 0 || length + written >= size) {
+            list[length] = 0;
+            break;
+        }
+        length += written;
+        cpu = last;
+    }
+    return length;
+}
+
+/**
+ * Find the online CPUs and the NUMA node of each from sysfs.
+ * The policy starts as PLACE_NONE.
+**/
+void ConstructPlacement(placement* p) {
+    p->policy = PLACE_NONE;
+    p->numa = false;
+    memset(&p->cpus, 0, sizeof(p->cpus));
+    memset(&p->online, 0, sizeof(p->online));
+    if (sched_getaffinity(0, sizeof(p->online), (cpu_set_t*) &p->online) < 0) AddCPU(&p->online, 0);
+    p->count = 0;
+    for (size_t cpu = 0; cpu < PLACEMENT_MAX_CPUS; cpu++)
+        if (HasCPU(&p->online, cpu)) p->count = cpu + 1;
+    p->next = 0;
+    p->nodes = malloc(sizeof(int) * p->count);
+    p->busy = calloc(p->count, sizeof(uint64_t));
+    p->total = calloc(p->count, sizeof(uint64_t));
+    p->load = calloc(p->count, sizeof(double));
+    p->sampled = (struct timespec) {0, 0};
+    for (size_t cpu = 0; cpu < p->count; cpu++) p->nodes[cpu] = -1;
+
+    // Every node directory lists the CPUs of that node.
+    DIR* dir = opendir("/sys/devices/system/node");
+    struct dirent* entry;
+    while (dir && (entry = readdir(dir))) {
+        int node;
+        if (sscanf(entry->d_name, "node%d", &node) != 1) continue;
+        char path[320], list[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/%s/cpulist", entry->d_name);
+        FILE* file = fopen(path, "r");
+        cpu_mask cpus;
+        if (file && fgets(list, sizeof(list), file) && ParseCPUList(list, &cpus)) {
+            for (size_t cpu = 0; cpu < p->count; cpu++)
+                if (HasCPU(&cpus, cpu)) p->nodes[cpu] = node;
+        }
+        if (file) fclose(file);
+    }
+    if (dir) closedir(dir);
+}
+
+/**
+ * Set the policy from its name: none, round-robin, least-loaded or a CPU list.
+ * @return false if the name is not a policy or the list has a CPU the shell cannot run on.
+**/
+bool SetPlacementPolicy(placement* p, const char* policy) {
+    if (strcmp(policy, "none") == 0) p->policy = PLACE_NONE;
+    else if (strcmp(policy, "round-robin") == 0) p->policy = PLACE_ROUND_ROBIN;
+    else if (strcmp(policy, "least-loaded") == 0) p->policy = PLACE_LEAST_LOADED;
+    else {
+        cpu_mask cpus;
+        if (!ParseCPUList(policy, &cpus)) return false;
+        for (size_t cpu = 0; cpu < PLACEMENT_MAX_CPUS; cpu++)
+            if (HasCPU(&cpus, cpu) && !HasCPU(&p->online, cpu)) return false;
+        p->cpus = cpus;
+        p->policy = PLACE_CPUS;
+    }
+    return true;
+}
+
+/**
+ * Get the name of the policy, PLACE_CPUS is named "cpus".
+**/
+const char* GetPlacementName(placement* p) {
+    switch (p->policy) {
+        case PLACE_ROUND_ROBIN: return "round-robin";
+        case PLACE_LEAST_LOADED: return "least-loaded";
+        case PLACE_CPUS: return "cpus";
+        default: return "none";
+    }
+}
+
+/**
+ * Read the busy and total ticks of every CPU from /proc/stat and set
+ *    placement::load to the busy fraction of each since the last sample.
+**/
+static void SampleLoad(placement* p) {
+    FILE* stat = fopen("/proc/stat", "r");
+    if (stat == NULL) return;
+    char line[512];
+    // The per CPU lines come right after the total and before everything else.
+    while (fgets(line, sizeof(line), stat) && strncmp(line, "cpu", 3) == 0) {
+        unsigned long cpu;
+        unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
+        if (sscanf(line, "cpu%lu %llu %llu %llu %llu %llu %llu %llu %llu", &cpu, &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal) != 9
+                || cpu >= p->count) continue;
+        uint64_t total = user + nice + system + idle + iowait + irq + softirq + steal;
+        uint64_t busy = total - idle - iowait;
+        uint64_t elapsed = total - p->total[cpu];
+        p->load[cpu] = elapsed > 0 ? (double) (busy - p->busy[cpu]) / elapsed : 0;
+        p->busy[cpu] = busy;
+        p->total[cpu] = total;
+    }
+    fclose(stat);
+}
+
+/**
+ * Choose where the next job runs.
+ * @param p The placement policy.
+ * @param cpus Set to the CPUs the job is pinned to.
+ * @param nodes Set to the NUMA nodes its memory is bound to, one bit per
+ *    node, or 0 for no binding.
+ * @return false if the policy is PLACE_NONE and the job is not placed.
+**/
+bool PlaceJob(placement* p, cpu_mask* cpus, unsigned long* nodes) {
+    if (p->policy == PLACE_NONE) return false;
+    memset(cpus, 0, sizeof(*cpus));
+    if (p->policy == PLACE_CPUS) {
+        *cpus = p->cpus;
+    } else {
+        size_t chosen = p->count;
+        if (p->policy == PLACE_ROUND_ROBIN) {
+            for (size_t i = 0; i < p->count && chosen == p->count; i++)
+                if (HasCPU(&p->online, (p->next + i) % p->count)) chosen = (p->next + i) % p->count;
+            p->next = chosen + 1;
+        } else {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if ((now.tv_sec - p->sampled.tv_sec) * 1000 + (now.tv_nsec - p->sampled.tv_nsec) / 1000000 >= PLACEMENT_SAMPLE_MS) {
+                SampleLoad(p);
+                p->sampled = now;
+            }
+            for (size_t cpu = 0; cpu < p->count; cpu++)
+                if (HasCPU(&p->online, cpu) && (chosen == p->count || p->load[cpu] < p->load[chosen])) chosen = cpu;
+            // Count the job as a busy CPU so a burst of jobs is spread before the next sample sees them.
+            p->load[chosen] += 1;
+        }
+        AddCPU(cpus, chosen);
+    }
+    *nodes = 0;
+    for (size_t cpu = 0; p->numa && cpu < p->count; cpu++) {
+        if (HasCPU(cpus, cpu) && p->nodes[cpu] >= 0 && p->nodes[cpu] < (int) MASK_BITS)
+            *nodes |= 1UL << p->nodes[cpu];
+    }
+    return true;
+}
+
+/**
+ * Pin a process to cpus and, for the calling process only, bind its memory to nodes.
+ * Only makes system calls so it is safe in a vfork child.
+ * @param pid The process or 0 for the caller.
+ * @param cpus The CPUs to run on.
+ * @param nodes The NUMA nodes to allocate from, one bit per node, or 0 to leave the memory policy alone.
+ * @return If every part of the placement was applied.
+**/
+bool ApplyPlacement(pid_t pid, const cpu_mask* cpus, unsigned long nodes) {
+    bool applied = sched_setaffinity(pid, sizeof(*cpus), (const cpu_set_t*) cpus) == 0;
+    if (nodes != 0) applied = pid == 0 && syscall(SYS_set_mempolicy, MPOL_BIND, &nodes, MASK_BITS + 1) == 0 && applied;
+    return applied;
+}
+
+/**
+ * Get the CPUs a process may run on.
+ * @return false if the process does not exist.
+**/
+bool GetAffinity(pid_t pid, cpu_mask* cpus) {
+    memset(cpus, 0, sizeof(*cpus));
+    return sched_getaffinity(pid, sizeof(*cpus), (cpu_set_t*) cpus) == 0;
+}
+
+/**
+ * Cleans up the placement.
+**/
+void DestroyPlacement(placement* p) {
+    free(p->nodes);
+    free(p->busy);
+    free(p->total);
+    free(p->load);
+}
\ No newline at end of file
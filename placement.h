@@ -0,0 +1,85 @@
+#ifndef placement_h
+#define placement_h
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/types.h>
+
+// The most CPUs a placement can name, the same as glibc's cpu_set_t.
+#define PLACEMENT_MAX_CPUS 1024
+// How long a /proc/stat sample is used to find the least loaded CPU.
+#define PLACEMENT_SAMPLE_MS 100
+
+/**
+ * A set of CPUs with the same layout as cpu_set_t so it can be passed
+ *    to sched_setaffinity without every file needing _GNU_SOURCE.
+**/
+typedef struct cpu_mask {
+    unsigned long bits[PLACEMENT_MAX_CPUS / (8 * sizeof(unsigned long))];
+} cpu_mask;
+
+/**
+ * Where background jobs are run.
+ * PLACE_NONE Jobs run wherever the kernel puts them.
+ * PLACE_ROUND_ROBIN Each job is pinned to the next online CPU.
+ * PLACE_LEAST_LOADED Each job is pinned to the CPU that was least busy
+ *    in /proc/stat, counting the jobs placed since the last sample.
+ * PLACE_CPUS Every job is pinned to placement::cpus.
+**/
+typedef enum placement_policy {
+    PLACE_NONE,
+    PLACE_ROUND_ROBIN,
+    PLACE_LEAST_LOADED,
+    PLACE_CPUS
+} placement_policy;
+
+/**=================================================================|
+ * The CPU and NUMA placement policy of background jobs.            |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * A job is pinned as a whole, every stage of a pipeline gets the   |
+ * same CPUs. With numa set the job's memory is also bound to the   |
+ * NUMA nodes of its CPUs. Placement is applied in the child before |
+ * exec so every thread the command starts inherits it.             |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * placement_policy policy How CPUs are chosen.                     |
+ * bool numa If memory is bound to the nodes of the chosen CPUs.    |
+ * cpu_mask online The CPUs the shell may run on, all others are    |
+ *      never chosen.                                               |
+ * cpu_mask cpus The CPUs of PLACE_CPUS.                            |
+ * size_t count One more than the highest online CPU.               |
+ * size_t next The CPU PLACE_ROUND_ROBIN tries next.                |
+ * int* nodes The NUMA node of every CPU or -1 if unknown.          |
+ * uint64_t* busy, * total The busy and total ticks of every CPU at |
+ *      the last sample.                                            |
+ * double* load The busy fraction of every CPU between the last two |
+ *      samples plus the jobs placed on it since.                   |
+ * struct timespec sampled When /proc/stat was last read.           |
+ * =================================================================|
+**/
+typedef struct placement {
+    placement_policy policy;
+    bool numa;
+    cpu_mask online;
+    cpu_mask cpus;
+    size_t count;
+    size_t next;
+    int* nodes;
+    uint64_t* busy;
+    uint64_t* total;
+    double* load;
+    struct timespec sampled;
+} placement;
+
+void ConstructPlacement(placement* p);
+bool SetPlacementPolicy(placement* p, const char* policy);
+bool PlaceJob(placement* p, cpu_mask* cpus, unsigned long* nodes);
+bool ParseCPUList(const char* list, cpu_mask* cpus);
+size_t FormatCPUList(const cpu_mask* cpus, char* list, size_t size);
+bool ApplyPlacement(pid_t pid, const cpu_mask* cpus, unsigned long nodes);
+bool GetAffinity(pid_t pid, cpu_mask* cpus);
+const char* GetPlacementName(placement* p);
+void DestroyPlacement(placement* p);
+#endif
\ No newline at end of file
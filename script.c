@@ -0,0 +1,309 @@
+#include "script.h"
+#include "launch.h"
+
+#include <ctype.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+
+// The target of a break until the end of its loop is compiled.
+#define UNPATCHED SIZE_MAX
+
+typedef enum keyword {
+    KEYWORD_NONE,
+    KEYWORD_FOR,
+    KEYWORD_WHILE,
+    KEYWORD_IF,
+    KEYWORD_ELSE,
+    KEYWORD_DONE,
+    KEYWORD_FI,
+    KEYWORD_BREAK,
+    KEYWORD_CONTINUE
+} keyword;
+
+static const char* Keywords[] = {NULL, "for", "while", "if", "else", "done", "fi", "break", "continue"};
+
+/**=================================================================|
+ * A for, while, if or else not yet closed while compiling.         |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * keyword type The keyword that opened the block.                  |
+ * size_t start Where continue and the end of a loop jump to.       |
+ * size_t branch The instruction to patch with the end of the block.|
+ * =================================================================|
+**/
+typedef struct script_block {
+    keyword type;
+    size_t start, branch;
+} script_block;
+
+/**
+ * Find the keyword the line starts with.
+ * @param line The line to look at.
+ * @param length The length of the line.
+ * @param end Set to the index after the first word.
+ * @return The keyword or KEYWORD_NONE if the first word is not one.
+**/
+static keyword FindKeyword(const char* line, size_t length, size_t* end) {
+    size_t start = 0;
+    while (start < length && isspace(line[start])) start++;
+    *end = start;
+    while (*end < length && !isspace(line[*end])) (*end)++;
+    for (keyword k = KEYWORD_FOR; k <= KEYWORD_CONTINUE; k++) {
+        if (strlen(Keywords[k]) == *end - start && memcmp(line + start, Keywords[k], *end - start) == 0)
+            return k;
+    }
+    return KEYWORD_NONE;
+}
+
+/**
+ * If only whitespace is left in the line.
+**/
+static bool IsBlank(const char* line, size_t length) {
+    for (size_t i = 0; i < length; i++)
+        if (!isspace(line[i])) return false;
+    return true;
+}
+
+/**
+ * If a line starts a script with for, while or if.
+**/
+bool IsScriptStart(const char* line, size_t length) {
+    size_t end;
+    keyword k = FindKeyword(line, length, &end);
+    return k == KEYWORD_FOR || k == KEYWORD_WHILE || k == KEYWORD_IF;
+}
+
+/**
+ * Initialize an empty script.
+**/
+void ConstructScript(script* s) {
+    InitMemoryManager(&s->manager);
+    s->code = ConstructManagedVector(sizeof(instruction), NULL, NULL, &s->manager);
+    s->lines = ConstructManagedVector(sizeof(script_line*), NULL, NULL, &s->manager);
+    s->loops = ConstructManagedVector(sizeof(script_loop), NULL, NULL, &s->manager);
+    s->blocks = ConstructManagedVector(sizeof(script_block), NULL, NULL, &s->manager);
+}
+
+/**
+ * Append an instruction.
+ * @return The index of the instruction.
+**/
+static size_t Emit(script* s, opcode op, size_t operand, size_t target) {
+    instruction i = {op, operand, target};
+    PushBackVector(&s->code, &i);
+    return s->code.length - 1;
+}
+
+/**
+ * Point the jump at index to the next instruction to be compiled.
+**/
+static void Patch(script* s, size_t index) {
+    ((instruction*) s->code.items)[index].target = s->code.length;
+}
+
+/**
+ * Parse a line of the script into a script_line that lives as long as the script.
+ * @return The index of the line in script::lines.
+**/
+static size_t AddLine(script* s, const char* text, size_t length) {
+    script_line* l = Alloc(&s->manager, sizeof(script_line));
+    ConstructManagedStr(&l->line, "", &s->manager);
+    AppendCStrN(&l->line, text, length);
+    // The command's words are views of its own copy of the text.
+    char* words = Alloc(&s->manager, length + 1);
+    memcpy(words, text, length);
+    words[length] = 0;
+    ConstructCommand(&l->c, length, words, &s->manager);
+    l->expands = memchr(text, '$', length) != NULL || HasWildcards(text, length);
+    if (!l->expands) BuildExecArgs(&l->c);
+    PushBackVector(&s->lines, &l);
+    return s->lines.length - 1;
+}
+
+/**
+ * Find the innermost open loop.
+ * @return The loop's block or NULL if there is none.
+**/
+static script_block* InnermostLoop(script* s) {
+    for (size_t i = s->blocks.length; i > 0; i--) {
+        script_block* b = ((script_block*) s->blocks.items) + i - 1;
+        if (b->type == KEYWORD_FOR || b->type == KEYWORD_WHILE) return b;
+    }
+    return NULL;
+}
+
+/**
+ * Compile the next line of a script. Blank lines and comments are skipped.
+ * Syntax errors are printed.
+ * @param s The script being compiled.
+ * @param line The line, a trailing newline is ignored.
+ * @param length The length of the line.
+ * @return SCRIPT_INCOMPLETE until the first block is closed, then SCRIPT_COMPLETE
+ *    or SCRIPT_ERROR if the line is not valid where it is.
+**/
+script_state CompileScriptLine(script* s, const char* line, size_t length) {
+    if (length > 0 && line[length - 1] == '\n') length--;
+    size_t end, start = 0;
+    while (start < length && isspace(line[start])) start++;
+    if (start == length || line[start] == '#') return SCRIPT_INCOMPLETE;
+
+    keyword k = FindKeyword(line, length, &end);
+    script_block* top = s->blocks.length > 0 ? ((script_block*) s->blocks.items) + s->blocks.length - 1 : NULL;
+    script_block* loop = k == KEYWORD_BREAK || k == KEYWORD_CONTINUE ? InnermostLoop(s) : NULL;
+    bool blank = IsBlank(line + end, length - end);
+    switch (k) {
+        case KEYWORD_NONE:
+            Emit(s, OP_RUN, AddLine(s, line, length), 0);
+            break;
+        case KEYWORD_FOR:
+            {
+                script_loop l = {((script_line**) s->lines.items)[AddLine(s, line, length)], ConstructVector(sizeof(string), CopyConstructStr, (void (*)(void*)) DestroyStr), 0};
+                string* args = l.header->c.args.items;
+                if (l.header->c.args.length < 2 || !IsVariableName(args[0].str, args[0].length) || strcmp(args[1].str, "in") != 0) {
+                    DestroyVector(&l.values);
+                    printf("Usage: for NAME in WORD...\n");
+                    return SCRIPT_ERROR;
+                }
+                PushBackVector(&s->loops, &l);
+                Emit(s, OP_FOR_START, s->loops.length - 1, 0);
+                size_t next = Emit(s, OP_FOR_NEXT, s->loops.length - 1, 0);
+                script_block b = {KEYWORD_FOR, next, next};
+                PushBackVector(&s->blocks, &b);
+            }
+            break;
+        case KEYWORD_WHILE:
+        case KEYWORD_IF:
+            {
+                if (blank) {
+                    printf("%s needs a command.\n", Keywords[k]);
+                    return SCRIPT_ERROR;
+                }
+                size_t condition = Emit(s, OP_RUN, AddLine(s, line + end, length - end), 0);
+                script_block b = {k, condition, Emit(s, OP_JUMP_FAILED, 0, 0)};
+                PushBackVector(&s->blocks, &b);
+            }
+            break;
+        case KEYWORD_ELSE:
+            if (!blank || top == NULL || top->type != KEYWORD_IF) goto unexpected;
+            {
+                size_t skip = Emit(s, OP_JUMP, 0, 0);
+                Patch(s, top->branch);
+                top->type = KEYWORD_ELSE;
+                top->branch = skip;
+            }
+            break;
+        case KEYWORD_DONE:
+            if (!blank || top == NULL || (top->type != KEYWORD_FOR && top->type != KEYWORD_WHILE)) goto unexpected;
+            Emit(s, OP_JUMP, 0, top->start);
+            Patch(s, top->branch);
+            // Inner loops patched their own breaks so the rest belong to this loop.
+            for (size_t i = top->start; i < s->code.length; i++) {
+                instruction* in = ((instruction*) s->code.items) + i;
+                if (in->op == OP_JUMP && in->target == UNPATCHED) in->target = s->code.length;
+            }
+            RemoveVector(&s->blocks, s->blocks.length - 1);
+            break;
+        case KEYWORD_FI:
+            if (!blank || top == NULL || (top->type != KEYWORD_IF && top->type != KEYWORD_ELSE)) goto unexpected;
+            Patch(s, top->branch);
+            RemoveVector(&s->blocks, s->blocks.length - 1);
+            break;
+        case KEYWORD_BREAK:
+        case KEYWORD_CONTINUE:
+            if (!blank || loop == NULL) goto unexpected;
+            Emit(s, OP_JUMP, 0, k == KEYWORD_BREAK ? UNPATCHED : loop->start);
+            break;
+    }
+    return s->blocks.length == 0 ? SCRIPT_COMPLETE : SCRIPT_INCOMPLETE;
+
+unexpected:
+    printf("Unexpected %.*s.\n", (int) (length - start), line + start);
+    return SCRIPT_ERROR;
+}
+
+/**
+ * Expand the words of a for loop into script_loop::values for a new run.
+ * Words with wildcards are replaced by the paths they match.
+**/
+static void StartLoop(shell* sh, script_loop* loop) {
+    ClearVector(&loop->values);
+    loop->next = 0;
+    string* args = loop->header->c.args.items;
+    for (size_t i = 2; i < loop->header->c.args.length; i++) {
+        string value;
+        ConstructStr(&value, args[i].str);
+        ExpandString(&value, &sh->vars);
+        // A word with wildcards loops over the paths it matches.
+        if (HasWildcards(value.str, value.length) && ExpandWildcard(&sh->dirs, value.str, &loop->values, NULL) > 0) DestroyStr(&value);
+        else PushBackVector(&loop->values, &value);
+    }
+}
+
+/**
+ * Run a line of a script. Lines with variables are expanded in a copy
+ *    made in shell::arena, which is reset after the line runs.
+**/
+static void RunScriptLine(shell* sh, script_line* l) {
+    if (!l->expands) {
+        RunCommandList(sh, &l->c, &l->line, false);
+        return;
+    }
+    command c;
+    DeepCopyCommand(&c, &l->c, &sh->arena);
+    RunCommandList(sh, &c, &l->line, true);
+    DestroyCommand(&c);
+    ResetMemoryManager(&sh->arena);
+}
+
+/**
+ * Run a compiled script until it ends, the shell exits or SIGINT is received.
+ * Signals are handled at the end of every loop iteration so a loop of
+ *    builtins can still be interrupted and reports background processes.
+**/
+void RunScript(shell* sh, script* s) {
+    instruction* code = s->code.items;
+    script_line** lines = s->lines.items;
+    script_loop* loop;
+    size_t pc = 0;
+    sh->interrupted = false;
+    while (pc < s->code.length && sh->running && !sh->interrupted) {
+        instruction* i = code + pc++;
+        switch (i->op) {
+            case OP_RUN:
+                RunScriptLine(sh, lines[i->operand]);
+                if (WIFSIGNALED(sh->status) && WTERMSIG(sh->status) == SIGINT) sh->interrupted = true;
+                break;
+            case OP_JUMP:
+                if (i->target < pc) HandleSignals(sh);
+                pc = i->target;
+                break;
+            case OP_JUMP_FAILED:
+                if (sh->status != 0) pc = i->target;
+                break;
+            case OP_FOR_START:
+                StartLoop(sh, ((script_loop*) s->loops.items) + i->operand);
+                break;
+            case OP_FOR_NEXT:
+                loop = ((script_loop*) s->loops.items) + i->operand;
+                if (loop->next == loop->values.length) {
+                    pc = i->target;
+                } else {
+                    string* name = loop->header->c.args.items;
+                    SetVariable(&sh->vars, name->str, name->length, ((string*) loop->values.items)[loop->next++].str, false);
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * Cleans up the script.
+**/
+void DestroyScript(script* s) {
+    for (size_t i = 0; i < s->loops.length; i++)
+        DestroyVector(&((script_loop*) s->loops.items)[i].values);
+    DestroyMemoryManager(&s->manager);
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef script_h
+#define script_h
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "command.h"
+#include "memory/manager.h"
+#include "shell.h"
+#include "string/str.h"
+#include "vector/vector.h"
+
+/**
+ * The instructions a script is compiled to.
+ * OP_RUN Run script::lines[operand].
+ * OP_JUMP Continue at target.
+ * OP_JUMP_FAILED Continue at target if "$?" is not 0.
+ * OP_FOR_START Expand the words of script::loops[operand] for a new run of the loop.
+ * OP_FOR_NEXT Set the variable of script::loops[operand] to its next word
+ *    or continue at target once the words run out.
+**/
+typedef enum opcode {
+    OP_RUN,
+    OP_JUMP,
+    OP_JUMP_FAILED,
+    OP_FOR_START,
+    OP_FOR_NEXT
+} opcode;
+
+/**
+ * If CompileScriptLine needs more lines, has finished the script or failed.
+**/
+typedef enum script_state {
+    SCRIPT_INCOMPLETE,
+    SCRIPT_COMPLETE,
+    SCRIPT_ERROR
+} script_state;
+
+typedef struct instruction {
+    opcode op;
+    size_t operand, target;
+} instruction;
+
+/**=================================================================|
+ * A command of a script, parsed once when the script is compiled.  |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * string line The command as typed, used for the job table.        |
+ * command c The parsed command, its words are not yet expanded.    |
+ * bool expands If the command has variables so a copy is expanded  |
+ *      before every run. Otherwise command::execArgs is built once.|
+ * =================================================================|
+**/
+typedef struct script_line {
+    string line;
+    command c;
+    bool expands;
+} script_line;
+
+/**=================================================================|
+ * A for NAME in WORD... loop of a script.                          |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * script_line* header The for line, its args are NAME, in and the  |
+ *      words.                                                      |
+ * vector values The expanded words of the current run.             |
+ * size_t next The index of the next value.                         |
+ * =================================================================|
+**/
+typedef struct script_loop {
+    script_line* header;
+    vector values;
+    size_t next;
+} script_loop;
+
+/**=================================================================|
+ * A block of lines compiled into instructions.                     |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * A script starts with a for, while or if line and ends at the     |
+ * matching done or fi:                                             |
+ *      for NAME in WORD...  while COMMAND  if COMMAND              |
+ *          ...                 ...            ...                  |
+ *      done                 done           else                    |
+ *                                             ...                  |
+ *                                          fi                      |
+ * break and continue apply to the innermost loop. Every line is    |
+ * tokenized once when it is compiled so running the loop body only |
+ * expands variables, which is skipped for lines without any.       |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * vector code The instructions.                                    |
+ * vector lines The script_line pointers run by OP_RUN.             |
+ * vector loops The script_loop of every for loop.                  |
+ * vector blocks The for, while, if and else instructions not yet   |
+ *      closed while compiling.                                     |
+ * memory_manager manager Holds every line and parsed command.      |
+ * =================================================================|
+**/
+typedef struct script {
+    vector code;
+    vector lines;
+    vector loops;
+    vector blocks;
+    memory_manager manager;
+} script;
+
+bool IsScriptStart(const char* line, size_t length);
+void ConstructScript(script* s);
+script_state CompileScriptLine(script* s, const char* line, size_t length);
+void RunScript(shell* sh, script* s);
+void DestroyScript(script* s);
+#endif
\ No newline at end of file
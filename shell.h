@@ -0,0 +1,100 @@
+#ifndef shell_h
+#define shell_h
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "capture.h"
+#include "history.h"
+#include "job.h"
+#include "jobqueue.h"
+#include "launch.h"
+#include "memory/manager.h"
+#include "parsecache.h"
+#include "pathcache.h"
+#include "placement.h"
+#include "vars.h"
+
+// The number of bytes read from the input at a time.
+#define SHELL_READ_SIZE 65536
+
+/**=================================================================|
+ * The state of a running shell.                                    |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * SIGCHLD, SIGINT and SIGTSTP are blocked and read from signalFD   |
+ * by the event loop so no state is touched by signal handlers.     |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * pid_t pid The shell's pid used to replace "$$".                  |
+ * int status The wait status of the last foreground process.       |
+ * bool running If the shell should keep reading commands.          |
+ * bool foregroundOnly If '&' is ignored.                           |
+ * size_t pendingToggles SIGTSTPs received while waiting on a       |
+ *      foreground process, applied once it exits.                  |
+ * bool interrupted If SIGINT was received, which stops a script.   |
+ * launch_backend backend How commands are started.                 |
+ * job_table jobs Every child process not yet reaped.               |
+ * path_cache paths Where commands were found in PATH.              |
+ * dir_cache dirs The directory listings wildcards are matched with.|
+ * job_queue queue Background commands waiting for a free slot.     |
+ * parse_cache parses Recently run lines already parsed and expanded|
+ * zygote_pool zygotes The helpers of the zygote backend, filled    |
+ *      while the shell is idle.                                    |
+ * variable_store vars The shell variables and exec environment.    |
+ * history history Every line run, shared with other shells.        |
+ * capture_table captures The output of background jobs, drained    |
+ *      whenever signals are handled.                               |
+ * placement placement The CPUs background jobs are pinned to.      |
+ * memory_manager arena Holds the parsed command of the current     |
+ *      line and is reset after it runs.                            |
+ * const char* traceFile Where the trace is written on exit or NULL.|
+ * int epollFD Watches inputFD, signalFD and the captures.          |
+ * int signalFD The signalfd for SIGCHLD, SIGINT and SIGTSTP.       |
+ * int inputFD Where commands are read from, stdin or a script.     |
+ * bool interactive If prompts are printed and flushed. Otherwise   |
+ *      the shell runs in batch mode and output is only flushed     |
+ *      before a child starts or the shell waits for input.         |
+ * bool pollInput If inputFD can be watched by epoll(not a file).   |
+ * bool inputClosed If inputFD has reached end of file.             |
+ * char* input Bytes read from inputFD, it grows to fit a line of   |
+ *      any length.                                                 |
+ * size_t inputStart Where the bytes not yet run start in input.    |
+ * size_t inputLength The number of bytes not yet run.              |
+ * size_t inputSize The size of input.                              |
+ * =================================================================|
+**/
+typedef struct shell {
+    pid_t pid;
+    int status;
+    bool running, foregroundOnly;
+    size_t pendingToggles;
+    bool interrupted;
+    launch_backend backend;
+    job_table jobs;
+    path_cache paths;
+    dir_cache dirs;
+    job_queue queue;
+    parse_cache parses;
+    zygote_pool zygotes;
+    variable_store vars;
+    history history;
+    capture_table captures;
+    placement placement;
+    memory_manager arena;
+    const char* traceFile;
+    int epollFD, signalFD, inputFD;
+    bool interactive, pollInput, inputClosed;
+    char* input;
+    size_t inputStart, inputLength, inputSize;
+} shell;
+const char* GetSearchPath(shell* sh);
+void SetStatus(shell* sh, int status);
+void ToggleForegroundOnly(shell* sh);
+size_t StartJob(shell* sh, command* c, string* line, bool background, int priority, pid_t* pids);
+size_t StartQueuedJobs(shell* sh);
+size_t HandleSignals(shell* sh);
+size_t ReadLine(shell* sh, string* line);
+size_t NextLine(shell* sh, string* line);
+void RunCommand(shell* sh, command* c, string* line);
+void RunCommandList(shell* sh, command* c, string* line, bool expand);
+#endif
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "stats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Hash command stats by their name.
+**/
+static size_t HashStats(const void* s) {
+    const command_stats* stats = s;
+    return HashBytes(stats->name.str, stats->name.length);
+}
+
+/**
+ * Compare two command stats by their names.
+**/
+static bool EqualsStats(const void* s1, const void* s2) {
+    const command_stats* stats1 = s1;
+    const command_stats* stats2 = s2;
+    return stats1->name.length == stats2->name.length && memcmp(stats1->name.str, stats2->name.str, stats1->name.length) == 0;
+}
+
+/**
+ * Moves the second command stats into the first.
+**/
+static void CopyConstructStats(void* s1, void* s2) {
+    memcpy(s1, s2, sizeof(command_stats));
+    CopyConstructStr(&((command_stats*) s1)->name, &((command_stats*) s1)->name);
+}
+
+/**
+ * Destroy the command stats name.
+**/
+static void DestroyStats(void* s) {
+    DestroyStr(&((command_stats*) s)->name);
+}
+
+/**
+ * The histogram bucket of a wall time in microseconds.
+**/
+static size_t Bucket(uint64_t micros) {
+    if (micros < 4) return micros;
+    size_t exponent = 63 - __builtin_clzll(micros);
+    return 4 * (exponent - 1) + ((micros >> (exponent - 2)) & 3);
+}
+
+/**
+ * The middle of a histogram bucket in microseconds.
+**/
+static uint64_t BucketMiddle(size_t bucket) {
+    if (bucket < 4) return bucket;
+    size_t exponent = bucket / 4 + 1;
+    uint64_t low = (4 + bucket % 4) << (exponent - 2);
+    return low + (1ULL << (exponent - 2)) / 2;
+}
+
+/**
+ * Initialize an empty stats table.
+**/
+void ConstructStatsTable(stats_table* table) {
+    table->commands = ConstructMap(sizeof(command_stats), HashStats, EqualsStats, CopyConstructStats, DestroyStats);
+}
+
+/**
+ * Add the resources used by one reaped process to its command's stats.
+ * @param table The table to record in.
+ * @param name The command name of the process.
+ * @param wall The wall time of the process in nanoseconds.
+ * @param usage The rusage of the process from wait4.
+**/
+void RecordStats(stats_table* table, const char* name, uint64_t wall, struct rusage* usage) {
+    command_stats probe;
+    ConstructStrView(&probe.name, (char*) name, strlen(name), NULL);
+    command_stats* stats = GetMap(&table->commands, &probe);
+    if (stats == NULL) {
+        memset(&probe, 0, sizeof(probe));
+        ConstructStr(&probe.name, name);
+        if ((stats = PutMap(&table->commands, &probe)) == NULL) {
+            DestroyStr(&probe.name);
+            return;
+        }
+    }
+    uint64_t micros = wall / 1000;
+    stats->runs++;
+    stats->wall += micros;
+    stats->user += usage->ru_utime.tv_sec * 1000000ULL + usage->ru_utime.tv_usec;
+    stats->sys += usage->ru_stime.tv_sec * 1000000ULL + usage->ru_stime.tv_usec;
+    if (micros > stats->maxWall) stats->maxWall = micros;
+    if (usage->ru_maxrss > stats->maxRSS) stats->maxRSS = usage->ru_maxrss;
+    stats->voluntarySwitches += usage->ru_nvcsw;
+    stats->involuntarySwitches += usage->ru_nivcsw;
+    stats->minorFaults += usage->ru_minflt;
+    stats->majorFaults += usage->ru_majflt;
+    stats->histogram[Bucket(micros)]++;
+}
+
+/**
+ * The wall time in microseconds that p of the runs finished within.
+**/
+static uint64_t Percentile(command_stats* stats, double p) {
+    size_t rank = (size_t) (p * stats->runs + 0.5), seen = 0;
+    if (rank == 0) rank = 1;
+    for (size_t i = 0; i < STATS_BUCKETS; i++) {
+        seen += stats->histogram[i];
+        if (seen >= rank) {
+            uint64_t middle = BucketMiddle(i);
+            return middle < stats->maxWall ? middle : stats->maxWall;
+        }
+    }
+    return stats->maxWall;
+}
+
+/**
+ * Format microseconds with a unit that keeps the number short.
+**/
+static const char* FormatTime(char* buffer, uint64_t micros) {
+    if (micros < 1000) sprintf(buffer, "%luus", (unsigned long) micros);
+    else if (micros < 1000000) sprintf(buffer, "%.1fms", micros / 1e3);
+    else sprintf(buffer, "%.2fs", micros / 1e6);
+    return buffer;
+}
+
+/**
+ * Print the stats of one command.
+**/
+static void PrintCommandStats(command_stats* stats) {
+    char p50[16], p90[16], p99[16], wall[16], user[16], sys[16];
+    printf("%-16s %6zu %9s %9s %9s %9s %9s %9s %9ld %9ld %9ld %9ld\n", stats->name.str, stats->runs,
+        FormatTime(p50, Percentile(stats, 0.5)), FormatTime(p90, Percentile(stats, 0.9)), FormatTime(p99, Percentile(stats, 0.99)),
+        FormatTime(wall, stats->wall), FormatTime(user, stats->user), FormatTime(sys, stats->sys),
+        stats->maxRSS, stats->voluntarySwitches + stats->involuntarySwitches, stats->minorFaults, stats->majorFaults);
+}
+
+/**
+ * Print the wall time percentiles and resource totals of every command,
+ *    or only of the command called name if it is not NULL.
+**/
+void PrintStats(stats_table* table, const char* name) {
+    if (table->commands.length == 0) {
+        printf("No commands have finished yet.\n");
+        return;
+    }
+    printf("%-16s %6s %9s %9s %9s %9s %9s %9s %9s %9s %9s %9s\n",
+        "command", "runs", "p50", "p90", "p99", "wall", "user", "sys", "maxrss kb", "switches", "minflt", "majflt");
+    size_t index = 0;
+    command_stats* stats;
+    while ((stats = NextMap(&table->commands, &index))) {
+        if (name == NULL || strcmp(name, stats->name.str) == 0) PrintCommandStats(stats);
+    }
+    fflush(stdout);
+}
+
+/**
+ * Forget the stats of every command.
+**/
+void ClearStats(stats_table* table) {
+    ClearMap(&table->commands);
+}
+
+/**
+ * Cleans up the stats table.
+**/
+void DestroyStatsTable(stats_table* table) {
+    DestroyMap(&table->commands);
+}
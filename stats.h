@@ -0,0 +1,60 @@
+#ifndef stats_h
+#define stats_h
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "map/map.h"
+#include "string/str.h"
+
+// 4 buckets for every power of 2 microseconds.
+#define STATS_BUCKETS 252
+
+/**=================================================================|
+ * The resources used by every process run as a command.            |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * Wall times are kept in a log-linear histogram with 4 buckets per |
+ * power of 2 microseconds so percentiles are within 25%.           |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * string name The command name, the key of the stats table.        |
+ * size_t runs The number of processes reaped.                      |
+ * uint64_t wall, user, sys The total wall, user and system time    |
+ *      in microseconds.                                            |
+ * uint64_t maxWall The longest wall time in microseconds.          |
+ * long maxRSS The largest max RSS in kilobytes.                    |
+ * long voluntarySwitches, involuntarySwitches Context switches.    |
+ * long minorFaults, majorFaults Page faults.                       |
+ * uint32_t histogram[] The number of runs in each wall time bucket.|
+ * =================================================================|
+**/
+typedef struct command_stats {
+    string name;
+    size_t runs;
+    uint64_t wall, user, sys;
+    uint64_t maxWall;
+    long maxRSS;
+    long voluntarySwitches, involuntarySwitches;
+    long minorFaults, majorFaults;
+    uint32_t histogram[STATS_BUCKETS];
+} command_stats;
+
+/**=================================================================|
+ * Resource accounting for each command name.                       |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * map commands The command_stats structs keyed by name.            |
+ * =================================================================|
+**/
+typedef struct stats_table {
+    map commands;
+} stats_table;
+
+void ConstructStatsTable(stats_table* table);
+void RecordStats(stats_table* table, const char* name, uint64_t wall, struct rusage* usage);
+void PrintStats(stats_table* table, const char* name);
+void ClearStats(stats_table* table);
+void DestroyStatsTable(stats_table* table);
+#endif
\ No newline at end of file
@@ -14,14 +14,74 @@
  * @return The constructed string.
 **/
 string* ConstructStr(string* s, const char* str) {
+    return ConstructManagedStr(s, str, NULL);
+}
+
+/**
+ * Constructs a string struct from a char* whose heap memory comes from a memory manager.
+ * Mallocs a string if the string location is NULL.
+ * @param s Is the location to store the string.
+ * @param str Is the initial contents of the string struct.
+ * @param manager Is the memory manager to allocate from or NULL for malloc.
+ * @return The constructed string.
+**/
+string* ConstructManagedStr(string* s, const char* str, memory_manager* manager) {
     if (s == NULL) s = malloc(sizeof(string));
     s->heap = false;
+    s->view = false;
     s->size = 32;
+    s->length = 0;
     s->str = (char*) s->s;
+    s->s[0] = 0;
+    s->manager = manager;
     if (str != NULL) SetCStr(s, str);
     return s;
 }
 
+/**
+ * Constructs a string struct which views a C string without copying it.
+ * The C string must outlive the string or any change to the string.
+ * Mallocs a string if the string location is NULL.
+ * @param s Is the location to store the string.
+ * @param str Is the null-terminated C string to view.
+ * @param length Is the length of str.
+ * @param manager Is the memory manager used once the view is copied or NULL for malloc.
+ * @return The constructed string.
+**/
+string* ConstructStrView(string* s, char* str, size_t length, memory_manager* manager) {
+    if (s == NULL) s = malloc(sizeof(string));
+    s->heap = false;
+    s->view = true;
+    s->length = length;
+    s->size = length + 1;
+    s->str = str;
+    s->manager = manager;
+    return s;
+}
+
+/**
+ * Turns a view into a string which owns its C string.
+ * @param s Is the view.
+ * @param keep Is if the viewed characters should be copied.
+**/
+static void Unview(string* s, bool keep) {
+    char* viewed = s->str;
+    s->view = false;
+    if (!keep || s->length + 1 <= 32) {
+        s->str = s->s;
+        s->size = 32;
+        s->heap = false;
+    } else {
+        s->str = Alloc(s->manager, sizeof(char) * (s->length + 1));
+        s->size = s->length + 1;
+        s->heap = true;
+    }
+    if (keep) {
+        memcpy(s->str, viewed, s->length);
+        s->str[s->length] = 0;
+    }
+}
+
 /**
  * Properly copies the second string into the first string.
  * @param v1 The pointer to the destination string.
@@ -31,7 +91,7 @@ void CopyConstructStr(void* v1, void* v2) {
     string* s1 = v1;
     string* s2 = v2;
     *s1 = *s2;
-    if (!s1->heap) s1->str = s1->s;
+    if (!s1->heap && !s1->view) s1->str = s1->s;
 //    printf("Copy Constructor: %s|%s|\n", s1->str, s2->str);
 }
 
@@ -45,15 +105,28 @@ void CopyConstructStr(void* v1, void* v2) {
 string* DeepCopy(string* dest, string* src) {
     if (dest == NULL) dest = malloc(sizeof(string));
     *dest = *src;
-    if (src->heap) {
-        dest->str = malloc(sizeof(char) * src->size);
-        strcpy(dest->str, src->str);
+    if (src->view) {
+        Unview(dest, true);
+    } else if (src->heap) {
+        dest->str = Alloc(dest->manager, sizeof(char) * src->size);
+        memcpy(dest->str, src->str, src->length + 1);
     } else {
         dest->str = dest->s;
     }
     return dest;
 }
 
+/**
+ * Makes sure a string can hold size chars for an append. The memory block is
+ * at least doubled when it grows so n appends only copy O(n) chars in total.
+ * @param dest The string to grow.
+ * @param size The number of chars needed including the null-terminator.
+**/
+static void Grow(string* dest, size_t size) {
+    if (dest->view) Unview(dest, true);
+    if (size > dest->size) ReserveStr(dest, size > dest->size * 2 ? size : dest->size * 2);
+}
+
 /**
  * Appends a char* to the end of the current string.
  * @param dest The string struct to append to.
@@ -61,19 +134,7 @@ string* DeepCopy(string* dest, string* src) {
  * @return The dest string.
 **/
 string* AppendCStr(string* dest, const char* src) {
-    size_t newLength = dest->length + strlen(src) + 1;
-    if (newLength > dest->size) {
-        if (dest->heap) ReallocProper((void**) &dest->str, sizeof(char), newLength, dest->size, NULL);
-        else {
-            dest->str = malloc(sizeof(char) * newLength);
-            strcpy(dest->str, dest->s);
-            dest->heap = true;
-        }
-        dest->size = newLength;
-    }
-    strcpy(dest->str + (sizeof(char) * dest->length), src);
-    dest->length = newLength - 1;
-    return dest;
+    return AppendCStrN(dest, src, strlen(src));
 }
 
 /**
@@ -83,45 +144,83 @@ string* AppendCStr(string* dest, const char* src) {
  * @return The dest string.
 **/
 string* AppendString(string* dest, string* src) {
-    size_t newLength = dest->length + src->length + 1;
-    if (newLength > dest->size) {
-        if (dest->heap) {
-            ReallocProper((void**) &dest->str, sizeof(char), newLength, dest->size, NULL);
-        } else {
-            dest->str = malloc(sizeof(char) * newLength);
-            strcpy(dest->str, dest->s);
+    return AppendCStrN(dest, src->str, src->length);
+}
+
+/**
+ * Appends length chars of a char* to the end of the current string.
+ * src does not need to be null-terminated.
+ * @param dest The string struct to append to.
+ * @param src The chars to append to the string struct.
+ * @param length The number of chars to append.
+ * @return The dest string.
+**/
+string* AppendCStrN(string* dest, const char* src, size_t length) {
+    Grow(dest, dest->length + length + 1);
+    memcpy(dest->str + (sizeof(char) * dest->length), src, length);
+    dest->length += length;
+    dest->str[dest->length] = 0;
+    return dest;
+}
+
+/**
+ * Makes sure a string's memory block can hold at least size chars
+ * so the appends that follow do not need to reallocate.
+ * @param dest The string to reserve memory for.
+ * @param size The number of chars including the null-terminator.
+ * @return The dest string.
+**/
+string* ReserveStr(string* dest, size_t size) {
+    if (dest->view) Unview(dest, true);
+    if (size > dest->size) {
+        if (dest->heap) ReallocProper(dest->manager, (void**) &dest->str, sizeof(char), size, dest->size, NULL);
+        else {
+            dest->str = Alloc(dest->manager, sizeof(char) * size);
+            memcpy(dest->str, dest->s, dest->length + 1);
             dest->heap = true;
         }
-        dest->size = newLength;
+        dest->size = size;
     }
-    memcpy(dest->str + (sizeof(char) * dest->length), src->str, src->length + 1);
-    //strcpy(dest->str + (sizeof(char) * dest->length), src->str);
-    dest->length = newLength - 1;
     return dest;
 }
 
 /**
- * Sets the contents of a string struct from a char*.
+ * Sets the contents of a string struct from length chars of a char*.
+ * src does not need to be null-terminated. A memory block that is big
+ * enough is reused, otherwise one that fits exactly is allocated.
  * @param dest Is the string to set the contents of.
- * @param src Is the char* data to set the contents to.
+ * @param src Is the chars to set the contents to.
+ * @param length Is the number of chars.
  * @return The dest string.
 **/
-string* SetCStr(string* dest, const char* src) {
-    size_t length = strlen(src) + 1;
-    if (dest->size < length) {
-        if (dest->heap) ReallocProper((void**) &dest->str, sizeof(char), length, dest->size, NULL);
-        else {
-            dest->str = malloc(sizeof(char) * length);
-            dest->heap = true;
-        }
+string* SetCStrN(string* dest, const char* src, size_t length) {
+    if (dest->view) Unview(dest, false);
+    if (dest->size < length + 1) {
+        // The old contents are replaced so a new block is used instead of copying them with realloc.
+        char* block = Alloc(dest->manager, sizeof(char) * (length + 1));
+        memcpy(block, src, length);
+        if (dest->heap) Free(dest->manager, dest->str);
+        dest->str = block;
+        dest->heap = true;
         dest->size = length + 1;
+    } else {
+        memmove(dest->str, src, length);
     }
-    strcpy(dest->str, src);
-    dest->length = length - 1;
-//    dest->size = (length+1) <= 32 ? 32 : length+1;
+    dest->str[length] = 0;
+    dest->length = length;
     return dest;
 }
 
+/**
+ * Sets the contents of a string struct from a char*.
+ * @param dest Is the string to set the contents of.
+ * @param src Is the char* data to set the contents to.
+ * @return The dest string.
+**/
+string* SetCStr(string* dest, const char* src) {
+    return SetCStrN(dest, src, strlen(src));
+}
+
 /**
  * Sets the contents of a string struct from another string struct. (Deep Copy)
  * @param dest Is the string to set the contents of.
@@ -129,17 +228,7 @@ string* SetCStr(string* dest, const char* src) {
  * @return The dest string.
 **/
 string* SetString(string* dest, string* src) {
-    if (dest->size < src->length) {
-        if (dest->heap) ReallocProper((void**) &dest->str, sizeof(char), src->length, dest->size, NULL);
-        else {
-            dest->str = malloc(sizeof(char) * src->length);
-            dest->heap = true;
-        }
-        dest->size = src->length;
-    }
-    strcpy(dest->str, src->str);
-    dest->length = src->length;
-    return dest;
+    return SetCStrN(dest, src->str, src->length);
 }
 
 /**
@@ -152,15 +241,15 @@ string* SetString(string* dest, string* src) {
 **/
 string* SubString(string* dest, string* src, size_t start, size_t end) {
     if (start > end) return NULL;
-    if (dest == NULL || !dest->heap) ConstructStr(dest, NULL);
+    if (dest == NULL || !dest->heap) ConstructManagedStr(dest, NULL, dest ? dest->manager : NULL);
     end = end <= src->length ? end : src->length;
     size_t length = end - start + 1;
     if (dest->size < length) {
         if (dest->heap) {
-            void* temp = ReallocProper((void**) &dest->str, sizeof(char), length, dest->size, NULL);
+            void* temp = ReallocProper(dest->manager, (void**) &dest->str, sizeof(char), length, dest->size, NULL);
             if (temp == NULL) return NULL;
         } else {
-            dest->str = malloc(sizeof(char) * length);
+            dest->str = Alloc(dest->manager, sizeof(char) * length);
             dest->heap = true;
         }
         dest->size = length;
@@ -186,12 +275,12 @@ string* SubStringReduce(string* dest, string* src, size_t start, size_t end) {
     size_t length = end - start + 1;
     if (length <= 32) {
         memcpy((void*) dest->s, (void*) (src->str + (sizeof(char) * start)), end - start);
-        free(dest->str);
+        Free(dest->manager, dest->str);
         dest->str = dest->s;
         dest->heap = false;
     } else {
         memcpy((void*) dest->str, (void*) (src->str + (sizeof(char) * start)), end - start);
-        dest->str = realloc((void*) dest->str, sizeof(char) * length);
+        dest->str = Realloc(dest->manager, (void*) dest->str, sizeof(char) * length);
     }
     dest->str[end - start] = 0;
     dest->length = length - 1;
@@ -201,19 +290,22 @@ string* SubStringReduce(string* dest, string* src, size_t start, size_t end) {
 
 /**
  * Reduces the size of a string to the length of the string.
+ * Call once a string built by appends is done to give back what doubling reserved.
  * @param str Is the string to reduce the size of.
  * @return The reduced string.
 **/
 string* ReduceString(string* str) {
     if (!str->heap || str->length + 1 == str->size) return str;
     if (str->length + 1 <= 32) {
-        strcpy(str->s, str->str);
-        free(str->str);
+        memcpy(str->s, str->str, str->length + 1);
+        Free(str->manager, str->str);
         str->str = str->s;
         str->heap = false;
         str->size = 32;
     } else {
-        void* temp = realloc(str->str, str->length + 1);
+        void* temp = Realloc(str->manager, str->str, str->length + 1);
+        if (temp == NULL) return str;
+        str->str = temp;
         str->size = str->length + 1;
     }
     return str;
@@ -236,6 +328,6 @@ int GetStrChar(string* src, size_t index) {
 **/
 void DestroyStr(string* string) {
     if (string->heap) {
-        free(string->str);
+        Free(string->manager, string->str);
     }
 }
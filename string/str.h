@@ -1,6 +1,10 @@
+#ifndef str_h
+#define str_h
 #include <stdlib.h>
 #include <stdbool.h>
 
+#include "../memory/manager.h"
+
 /**=================================================================|
  * A basic string struct.                                           |
  * =================================================================|
@@ -11,34 +15,44 @@
  * this string. If the string is located on the heap that means     |
  * if it is within the 32 character limit the string is stored in   |
  * contiguous memory and will not be fragmented.                    |
+ * A string can also be a view of a C string it does not own. The   |
+ * view is copied into the string the first time it is changed.     |
  * =================================================================|
  * >>> Member Information.                                          |
  * bool heap If the underlying C string is stored on the heap.      |
+ * bool view If str points to memory owned by someone else.         |
  * size_t length The number of characters excluding the null-       |
  *      terminator.                                                 |
  * size_t size The size of the C string memory block.               |
  * char* str The accurate pointer to the string memory block.       |
  * char s[32] The 32 chars stored inside the string.                |
- * =================================================================|
- * Struct Size: 64 bytes on 64 bit systems and 48 on 32 bit systems.|
+ * memory_manager* manager Where heap memory comes from, NULL for   |
+ *      malloc.                                                     |
  * =================================================================|
 **/
 typedef struct string {
-    bool heap;
+    bool heap, view;
     size_t length, size;
     char* str;
     char s[32];
+    memory_manager* manager;
 } string;
 
 string* ConstructStr(string* s, const char* str);
+string* ConstructManagedStr(string* s, const char* str, memory_manager* manager);
+string* ConstructStrView(string* s, char* str, size_t length, memory_manager* manager);
 void CopyConstructStr(void* s1, void* s2);
 string* DeepCopy(string* dest, string* src);
 string* AppendCStr(string* dest, const char* src);
 string* AppendString(string* dest, string* src);
+string* AppendCStrN(string* dest, const char* src, size_t length);
+string* ReserveStr(string* dest, size_t size);
 string* SetCStr(string* dest, const char* str);
+string* SetCStrN(string* dest, const char* str, size_t length);
 string* SetString(string* dest, string* src);
 string* SubString(string* dest, string* src, size_t start, size_t end);
 string* SubStringReduce(string* dest, string* src, size_t start, size_t end);
 string* ReduceString(string* str);
 int GetStrChar(string* src, size_t index);
 void DestroyStr(string* string);
+#endif
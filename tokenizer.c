@@ -0,0 +1,126 @@
+#include "tokenizer.h"
+
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * If c separates words, is an operator or starts an expansion.
+**/
+static bool IsSpecial(char c) {
+    switch (c) {
+        case ' ': case '\t': case '\n': case '<': case '>': case '|': case '&': case ';': case '$':
+            return true;
+        default:
+            return false;
+    }
+}
+
+#if defined(__AVX2__)
+/**
+ * Classify 32 bytes at once, one mask bit per special byte.
+**/
+static uint32_t SpecialMask32(const char* bytes) {
+    __m256i b = _mm256_loadu_si256((const __m256i*) bytes);
+    __m256i m = _mm256_cmpeq_epi8(b, _mm256_set1_epi8(' '));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(b, _mm256_set1_epi8('\t')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(b, _mm256_set1_epi8('\n')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(b, _mm256_set1_epi8('<')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(b, _mm256_set1_epi8('>')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(b, _mm256_set1_epi8('|')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(b, _mm256_set1_epi8('&')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(b, _mm256_set1_epi8(';')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(b, _mm256_set1_epi8('$')));
+    return (uint32_t) _mm256_movemask_epi8(m);
+}
+#elif defined(__SSE2__)
+/**
+ * Classify 16 bytes at once, one mask bit per special byte.
+**/
+static uint32_t SpecialMask16(const char* bytes) {
+    __m128i b = _mm_loadu_si128((const __m128i*) bytes);
+    __m128i m = _mm_cmpeq_epi8(b, _mm_set1_epi8(' '));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(b, _mm_set1_epi8('\t')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(b, _mm_set1_epi8('\n')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(b, _mm_set1_epi8('<')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(b, _mm_set1_epi8('>')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(b, _mm_set1_epi8('|')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(b, _mm_set1_epi8('&')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(b, _mm_set1_epi8(';')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(b, _mm_set1_epi8('$')));
+    return (uint32_t) _mm_movemask_epi8(m);
+}
+#endif
+
+/**
+ * Find the index of the next special byte at or after i.
+ * Whole blocks are classified with SIMD when available and
+ *    the tail that does not fill a block is scanned one byte at a time.
+ * @return The index of the special byte or length if there is none.
+**/
+static size_t NextSpecial(const char* line, size_t i, size_t length) {
+#if defined(__AVX2__)
+    for (; i + 32 <= length; i += 32) {
+        uint32_t mask = SpecialMask32(line + i);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= length; i += 16) {
+        uint32_t mask = SpecialMask16(line + i);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#endif
+    while (i < length && !IsSpecial(line[i])) i++;
+    return i;
+}
+
+/**
+ * Split a command line into words and the operators <, >, |, &, ;, && and ||.
+ * Operators do not need to be separated from words by spaces.
+ * Nothing is copied, each token is an offset and length into the line.
+ * @param tokens The vector of token structs to push the tokens onto.
+ * @param line The command line.
+ * @param length The length of the line.
+ * @return The number of tokens pushed.
+**/
+size_t Tokenize(vector* tokens, const char* line, size_t length) {
+    size_t count = 0, i = 0;
+    while (i < length) {
+        token t = {i, 1, TOKEN_WORD, false};
+        switch (line[i]) {
+            case ' ': case '\t': case '\n':
+                i++;
+                continue;
+            case '<': t.type = TOKEN_INPUT; break;
+            case '>': t.type = TOKEN_OUTPUT; break;
+            case '|':
+                t.type = i + 1 < length && line[i + 1] == '|' ? TOKEN_OR : TOKEN_PIPE;
+                t.length = t.type == TOKEN_OR ? 2 : 1;
+                break;
+            case '&':
+                t.type = i + 1 < length && line[i + 1] == '&' ? TOKEN_AND : TOKEN_BACKGROUND;
+                t.length = t.type == TOKEN_AND ? 2 : 1;
+                break;
+            case ';': t.type = TOKEN_SEQUENCE; break;
+            default:
+                {
+                    // A word runs until a separator or operator, a '$' only marks it for expansion.
+                    size_t end = NextSpecial(line, i, length);
+                    while (end < length && line[end] == '$') {
+                        t.expand = true;
+                        end = NextSpecial(line, end + 1, length);
+                    }
+                    t.length = end - i;
+                }
+                break;
+        }
+        i += t.length;
+        PushBackVector(tokens, &t);
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,36 @@
+#ifndef tokenizer_h
+#define tokenizer_h
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "vector/vector.h"
+
+typedef enum token_type {
+    TOKEN_WORD,
+    TOKEN_INPUT,      // <
+    TOKEN_OUTPUT,     // >
+    TOKEN_PIPE,       // |
+    TOKEN_BACKGROUND, // &
+    TOKEN_SEQUENCE,   // ;
+    TOKEN_AND,        // &&
+    TOKEN_OR          // ||
+} token_type;
+
+/**=================================================================|
+ * A view of one token of a command line.                           |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * size_t offset The index of the first character in the line.      |
+ * size_t length The number of characters in the token.             |
+ * token_type type If the token is a word or which operator it is.  |
+ * bool expand If the word contains a '$' and may need expansion.   |
+ * =================================================================|
+**/
+typedef struct token {
+    size_t offset, length;
+    token_type type;
+    bool expand;
+} token;
+
+size_t Tokenize(vector* tokens, const char* line, size_t length);
+#endif
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+trace_ring* GTrace = NULL;
+pid_t GTracePid = 0;
+
+static const char* traceNames[] = {"read", "parse", "expand", "fork", "exec", "redirect", "wait", "reap"};
+
+/**
+ * Map the ring buffer and start recording events.
+ * @return False if the buffer could not be mapped.
+**/
+bool StartTrace() {
+    if (GTrace) return true;
+    void* ring = mmap(NULL, sizeof(trace_ring), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) return false;
+    GTracePid = getpid();
+    GTrace = ring;
+    return true;
+}
+
+/**
+ * Record an event, overwriting the oldest once the ring is full.
+ * Only async-signal-safe calls are made so children may record events before exec.
+ * @param type What happened.
+ * @param phase 'B' to begin a span, 'E' to end it or 'i' for an instant.
+ * @param pid The process recording the event.
+ * @param arg A pid or other value shown with the event.
+**/
+void TraceRecord(trace_type type, char phase, pid_t pid, uint64_t arg) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t slot = __atomic_fetch_add(&GTrace->next, 1, __ATOMIC_RELAXED);
+    trace_event* event = GTrace->events + (slot & (TRACE_CAPACITY - 1));
+    event->time = now.tv_sec * 1000000000ULL + now.tv_nsec;
+    event->arg = arg;
+    event->pid = pid;
+    event->type = type;
+    event->phase = phase;
+}
+
+/**
+ * Write the recorded events as Chrome trace JSON, which Perfetto also reads.
+ * Every process gets its own track under the shell.
+ * @return False if the file could not be written.
+**/
+bool DumpTrace(const char* path) {
+    if (GTrace == NULL) return false;
+    FILE* out = fopen(path, "w");
+    if (out == NULL) return false;
+    uint64_t end = __atomic_load_n(&GTrace->next, __ATOMIC_ACQUIRE);
+    uint64_t start = end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+    fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    for (uint64_t i = start; i < end; i++) {
+        trace_event* event = GTrace->events + (i & (TRACE_CAPACITY - 1));
+        fprintf(out, "%s\n{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %lu.%03lu, \"pid\": %d, \"tid\": %d, %s\"args\": {\"arg\": %lu}}",
+            i == start ? "" : ",", traceNames[event->type], event->phase,
+            (unsigned long) (event->time / 1000), (unsigned long) (event->time % 1000), GTracePid, event->pid,
+            event->phase == 'i' ? "\"s\": \"t\", " : "", (unsigned long) event->arg);
+    }
+    fprintf(out, "\n]}\n");
+    return fclose(out) == 0;
+}
+
+/**
+ * Stop recording events and unmap the ring buffer.
+**/
+void StopTrace() {
+    if (GTrace == NULL) return;
+    munmap(GTrace, sizeof(trace_ring));
+    GTrace = NULL;
+}
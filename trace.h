@@ -0,0 +1,82 @@
+#ifndef trace_h
+#define trace_h
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+// The number of events kept, the oldest are overwritten. Must be a power of 2.
+#define TRACE_CAPACITY (1 << 16)
+
+/**
+ * The shell activity that can be traced.
+**/
+typedef enum trace_type {
+    TRACE_READ,
+    TRACE_PARSE,
+    TRACE_EXPAND,
+    TRACE_FORK,
+    TRACE_EXEC,
+    TRACE_REDIRECT,
+    TRACE_WAIT,
+    TRACE_REAP
+} trace_type;
+
+/**=================================================================|
+ * One timestamped event.                                           |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * uint64_t time When the event happened in monotonic nanoseconds.  |
+ * uint64_t arg A pid or other value shown with the event.          |
+ * pid_t pid The process that recorded the event.                   |
+ * uint16_t type The trace_type of the event.                       |
+ * char phase 'B' to begin a span, 'E' to end it or 'i' for instant.|
+ * =================================================================|
+**/
+typedef struct trace_event {
+    uint64_t time;
+    uint64_t arg;
+    pid_t pid;
+    uint16_t type;
+    char phase;
+} trace_event;
+
+/**=================================================================|
+ * A ring buffer of events in a shared anonymous mapping.           |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * The mapping is shared so fork and vfork children can record      |
+ * events too. Writers claim a slot with an atomic add so recording |
+ * never locks or allocates.                                        |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * uint64_t next The number of events ever recorded.                |
+ * trace_event events[] The last TRACE_CAPACITY events.             |
+ * =================================================================|
+**/
+typedef struct trace_ring {
+    uint64_t next;
+    trace_event events[TRACE_CAPACITY];
+} trace_ring;
+
+// NULL unless tracing is on so every trace call is one branch when off.
+extern trace_ring* GTrace;
+extern pid_t GTracePid;
+
+bool StartTrace();
+void TraceRecord(trace_type type, char phase, pid_t pid, uint64_t arg);
+bool DumpTrace(const char* path);
+void StopTrace();
+
+static inline void TraceBegin(trace_type type, uint64_t arg) {
+    if (GTrace) TraceRecord(type, 'B', GTracePid, arg);
+}
+
+static inline void TraceEnd(trace_type type, uint64_t arg) {
+    if (GTrace) TraceRecord(type, 'E', GTracePid, arg);
+}
+
+static inline void TraceInstant(trace_type type, uint64_t arg) {
+    if (GTrace) TraceRecord(type, 'i', GTracePid, arg);
+}
+#endif
\ No newline at end of file
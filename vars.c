@@ -0,0 +1,287 @@
+#include "vars.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Hash a variable by its name.
+**/
+static size_t HashVariable(const void* v) {
+    const variable* var = v;
+    return HashBytes(var->name.str, var->name.length);
+}
+
+/**
+ * Compare two variables by their names.
+**/
+static bool EqualsVariable(const void* v1, const void* v2) {
+    const variable* var1 = v1;
+    const variable* var2 = v2;
+    return var1->name.length == var2->name.length && memcmp(var1->name.str, var2->name.str, var1->name.length) == 0;
+}
+
+/**
+ * Moves the second variable into the first variable.
+**/
+static void CopyConstructVariable(void* v1, void* v2) {
+    variable* var = v1;
+    *var = *(variable*) v2;
+    CopyConstructStr(&var->name, &var->name);
+    CopyConstructStr(&var->value, &var->value);
+}
+
+/**
+ * Destroy the variable's strings. The environment entry is owned by the store.
+**/
+static void DestroyVariable(void* v) {
+    DestroyStr(&((variable*) v)->name);
+    DestroyStr(&((variable*) v)->value);
+}
+
+/**
+ * Find a variable by name.
+**/
+static variable* FindVariable(variable_store* store, const char* name, size_t length) {
+    variable probe;
+    ConstructStrView(&probe.name, (char*) name, length, NULL);
+    return GetMap(&store->variables, &probe);
+}
+
+/**
+ * Build the "name=value" environment entry of a variable.
+**/
+static char* ConstructEntry(variable* var) {
+    char* entry = malloc(var->name.length + var->value.length + 2);
+    memcpy(entry, var->name.str, var->name.length);
+    entry[var->name.length] = '=';
+    memcpy(entry + var->name.length + 1, var->value.str, var->value.length + 1);
+    return entry;
+}
+
+/**
+ * Initialize the store with every variable of an environment exported.
+ * @param store The store to initialize.
+ * @param environ The NULL terminated "name=value" environment to import.
+**/
+void ConstructVariableStore(variable_store* store, char** environ) {
+    store->variables = ConstructMap(sizeof(variable), HashVariable, EqualsVariable, CopyConstructVariable, DestroyVariable);
+    store->environment = ConstructVector(sizeof(char*), NULL, NULL);
+    char* end = NULL;
+    PushBackVector(&store->environment, &end);
+    store->generation = 0;
+    for (; environ != NULL && *environ != NULL; environ++) {
+        char* equals = strchr(*environ, '=');
+        if (equals != NULL) SetVariable(store, *environ, equals - *environ, equals + 1, true);
+    }
+}
+
+/**
+ * Get the value of a variable.
+ * @param store The store to search.
+ * @param name The name of the variable, it does not need to be null-terminated.
+ * @param length The length of the name.
+ * @return The value or NULL if the variable is not set.
+**/
+const char* GetVariable(variable_store* store, const char* name, size_t length) {
+    variable* var = FindVariable(store, name, length);
+    return var ? var->value.str : NULL;
+}
+
+/**
+ * Put a variable's entry into the environment or update its entry in place.
+**/
+static void PutEntry(variable_store* store, variable* var) {
+    char** environment = store->environment.items;
+    if (var->entry != NULL) {
+        free(var->entry);
+        var->entry = environment[var->envIndex] = ConstructEntry(var);
+        return;
+    }
+    // Replace the NULL terminator with the entry and terminate again.
+    var->entry = ConstructEntry(var);
+    var->envIndex = store->environment.length - 1;
+    environment[var->envIndex] = var->entry;
+    char* end = NULL;
+    PushBackVector(&store->environment, &end);
+}
+
+/**
+ * Remove a variable's entry from the environment by moving the last entry into its place.
+**/
+static void RemoveEntry(variable_store* store, variable* var) {
+    if (var->entry == NULL) return;
+    char** environment = store->environment.items;
+    size_t last = store->environment.length - 2;
+    if (var->envIndex != last) {
+        char* moved = environment[last];
+        variable* owner = FindVariable(store, moved, strchr(moved, '=') - moved);
+        environment[var->envIndex] = moved;
+        owner->envIndex = var->envIndex;
+    }
+    environment[last] = NULL;
+    store->environment.length--;
+    free(var->entry);
+    var->entry = NULL;
+}
+
+/**
+ * Set the value of a variable creating it if needed.
+ * @param store The store to set the variable in.
+ * @param name The name of the variable, it does not need to be null-terminated.
+ * @param length The length of the name.
+ * @param value The value of the variable.
+ * @param exported If the variable should be put into the environment.
+ *    An already exported variable stays exported.
+ * @return If the variable could be set.
+**/
+bool SetVariable(variable_store* store, const char* name, size_t length, const char* value, bool exported) {
+    variable* var = FindVariable(store, name, length);
+    if (var == NULL) {
+        variable v;
+        ConstructStr(&v.name, NULL);
+        AppendCStrN(&v.name, name, length);
+        ConstructStr(&v.value, value);
+        v.entry = NULL;
+        v.envIndex = 0;
+        if ((var = PutMap(&store->variables, &v)) == NULL) {
+            DestroyVariable(&v);
+            return false;
+        }
+    } else {
+        SetCStr(&var->value, value);
+    }
+    if (exported || var->entry != NULL) PutEntry(store, var);
+    // "?" changes after every command so it is left out of the generation.
+    if (length != 1 || *name != '?') store->generation++;
+    return true;
+}
+
+/**
+ * Put an existing variable into the environment.
+ * @return If the variable exists.
+**/
+bool ExportVariable(variable_store* store, const char* name, size_t length) {
+    variable* var = FindVariable(store, name, length);
+    if (var == NULL) return false;
+    if (var->entry == NULL) PutEntry(store, var);
+    store->generation++;
+    return true;
+}
+
+/**
+ * Remove a variable from the store and the environment.
+ * @return If the variable existed.
+**/
+bool UnsetVariable(variable_store* store, const char* name, size_t length) {
+    variable* var = FindVariable(store, name, length);
+    if (var == NULL) return false;
+    RemoveEntry(store, var);
+    RemoveMap(&store->variables, var);
+    store->generation++;
+    return true;
+}
+
+/**
+ * If the chars are a valid variable name, a letter or '_' followed by letters, digits or '_'.
+**/
+bool IsVariableName(const char* name, size_t length) {
+    if (length == 0 || isdigit((unsigned char) name[0])) return false;
+    for (size_t i = 0; i < length; i++)
+        if (!isalnum((unsigned char) name[i]) && name[i] != '_') return false;
+    return true;
+}
+
+/**
+ * Get the NULL terminated environment to pass to exec.
+**/
+char** GetEnvironment(variable_store* store) {
+    return store->environment.items;
+}
+
+/**
+ * Find the variable reference starting at the '$' at index i.
+ * Recognizes $$, $?, $NAME and ${NAME}.
+ * @param name Is set to the start of the name.
+ * @param length Is set to the length of the name.
+ * @return The length of the whole reference or 0 if it is a plain '$'.
+**/
+static size_t ParseReference(const char* str, size_t i, size_t strLength, const char** name, size_t* length) {
+    const char* start = str + i + 1;
+    size_t left = strLength - i - 1;
+    if (left > 0 && (*start == '$' || *start == '?')) {
+        *name = start;
+        *length = 1;
+        return 2;
+    }
+    if (left > 1 && *start == '{') {
+        const char* close = memchr(start, '}', left);
+        if (close == NULL || !IsVariableName(start + 1, close - start - 1)) return 0;
+        *name = start + 1;
+        *length = close - start - 1;
+        return *length + 3;
+    }
+    size_t n = 0;
+    while (n < left && (isalnum((unsigned char) start[n]) || start[n] == '_')) n++;
+    if (!IsVariableName(start, n)) return 0;
+    *name = start;
+    *length = n;
+    return n + 1;
+}
+
+/**
+ * Expand $$, $?, $NAME and ${NAME} in a string in a single linear pass.
+ * Unset variables expand to nothing. A string without a '$' is left
+ *    untouched so a view stays a view.
+ * The output length is measured first so the result is allocated once.
+ * @param s The string to expand.
+ * @param store The variables to expand from.
+ * @return The expanded string.
+**/
+string* ExpandString(string* s, variable_store* store) {
+    const char* dollar = memchr(s->str, '$', s->length);
+    if (dollar == NULL) return s;
+    const char* name;
+    size_t nameLength, total = 0;
+    for (size_t i = dollar - s->str; i < s->length; i++) {
+        size_t skip;
+        if (s->str[i] == '$' && (skip = ParseReference(s->str, i, s->length, &name, &nameLength)) > 0) {
+            const char* value = GetVariable(store, name, nameLength);
+            if (value != NULL) total += strlen(value);
+            i += skip - 1;
+        } else {
+            total++;
+        }
+    }
+
+    string expanded;
+    ConstructManagedStr(&expanded, NULL, s->manager);
+    ReserveStr(&expanded, (dollar - s->str) + total + 1);
+    AppendCStrN(&expanded, s->str, dollar - s->str);
+    size_t run = dollar - s->str;
+    for (size_t i = run; i < s->length; i++) {
+        size_t skip;
+        if (s->str[i] == '$' && (skip = ParseReference(s->str, i, s->length, &name, &nameLength)) > 0) {
+            AppendCStrN(&expanded, s->str + run, i - run);
+            const char* value = GetVariable(store, name, nameLength);
+            if (value != NULL) AppendCStrN(&expanded, value, strlen(value));
+            i += skip - 1;
+            run = i + 1;
+        }
+    }
+    AppendCStrN(&expanded, s->str + run, s->length - run);
+    DestroyStr(s);
+    *s = expanded;
+    CopyConstructStr(s, s);
+    return s;
+}
+
+/**
+ * Cleans up the store and its environment.
+**/
+void DestroyVariableStore(variable_store* store) {
+    char** environment = store->environment.items;
+    for (size_t i = 0; i + 1 < store->environment.length; i++) free(environment[i]);
+    DestroyVector(&store->environment);
+    DestroyMap(&store->variables);
+}
@@ -0,0 +1,60 @@
+#ifndef vars_h
+#define vars_h
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "map/map.h"
+#include "string/str.h"
+#include "vector/vector.h"
+
+/**=================================================================|
+ * A shell variable.                                                |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * string name The name of the variable, the key of the store.      |
+ * string value The value of the variable.                          |
+ * char* entry The "name=value" string in the environment or NULL   |
+ *      if the variable is not exported.                            |
+ * size_t envIndex The index of entry in the environment.           |
+ * =================================================================|
+**/
+typedef struct variable {
+    string name;
+    string value;
+    char* entry;
+    size_t envIndex;
+} variable;
+
+/**=================================================================|
+ * The shell's variables and the environment passed to exec.        |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * The environment is updated in place whenever an exported         |
+ * variable changes so launching a command never rebuilds it. The   |
+ * special parameters "$" and "?" are stored as unexported          |
+ * variables so expansion treats them like any other variable.      |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * map variables The variable structs keyed by variable::name.      |
+ * vector environment The char* entries of the exported variables   |
+ *      followed by NULL, usable as envp.                           |
+ * size_t generation Incremented whenever any variable other than   |
+ *      "?" changes, which changes after every command.             |
+ * =================================================================|
+**/
+typedef struct variable_store {
+    map variables;
+    vector environment;
+    size_t generation;
+} variable_store;
+
+void ConstructVariableStore(variable_store* store, char** environ);
+const char* GetVariable(variable_store* store, const char* name, size_t length);
+bool SetVariable(variable_store* store, const char* name, size_t length, const char* value, bool exported);
+bool ExportVariable(variable_store* store, const char* name, size_t length);
+bool UnsetVariable(variable_store* store, const char* name, size_t length);
+bool IsVariableName(const char* name, size_t length);
+char** GetEnvironment(variable_store* store);
+string* ExpandString(string* s, variable_store* store);
+void DestroyVariableStore(variable_store* store);
+#endif
\ No newline at end of file
@@ -15,7 +15,21 @@
  * @return The constructed vector.
 **/
 vector ConstructVector(size_t typeSize, void (*copyConstructor)(void*, void*), void (*destructor)(void*)) {
-    vector vec = {0, 4, typeSize, malloc(typeSize * 4), copyConstructor, destructor};
+    return ConstructManagedVector(typeSize, copyConstructor, destructor, NULL);
+}
+
+/**
+ * Creates a vector struct with a size of 4 whose items come from a memory manager.
+ * @param typeSize Is the size of the type the vector contains.
+ * @param copyConstructor Is an optional function for performing
+ *   a copy on the underlying object.
+ * @param destructor Is an optional function for performing cleanup
+ *   on the underlying object.
+ * @param manager Is the memory manager to allocate from or NULL for malloc.
+ * @return The constructed vector.
+**/
+vector ConstructManagedVector(size_t typeSize, void (*copyConstructor)(void*, void*), void (*destructor)(void*), memory_manager* manager) {
+    vector vec = {0, 4, typeSize, Alloc(manager, typeSize * 4), copyConstructor, destructor, manager};
     return vec;
 }
 
@@ -26,7 +40,7 @@ vector ConstructVector(size_t typeSize, void (*copyConstructor)(void*, void*), v
 **/
 vector DeepCopyVector(vector* v) {
     vector vec = *v;
-    vec.items = malloc(vec.size * vec.typeSize);
+    vec.items = Alloc(vec.manager, vec.size * vec.typeSize);
     if (vec.copyConstructor) {
         for (int i = 0; i < vec.length; i++) {
             vec.copyConstructor(((uint8_t*) vec.items) + vec.typeSize * i, ((uint8_t*) v->items) + v->typeSize * i);
@@ -45,12 +59,12 @@ vector DeepCopyVector(vector* v) {
  * @return The sub-vector.
 **/
 vector SubVector(vector* v, size_t start, size_t end) {
-    if (start >= v->length) return ConstructVector(v->typeSize, v->copyConstructor, v->destructor);
+    if (start >= v->length) return ConstructManagedVector(v->typeSize, v->copyConstructor, v->destructor, v->manager);
     size_t subLength = v->length - start;
-    vector vec = {0, 0, v->typeSize, NULL, v->copyConstructor};
+    vector vec = {0, 0, v->typeSize, NULL, v->copyConstructor, NULL, v->manager};
     vec.size = end - start + 1;
     vec.length = vec.size < subLength ? vec.size : subLength;
-    vec.items = malloc(vec.typeSize * vec.size);
+    vec.items = Alloc(vec.manager, vec.typeSize * vec.size);
     if (vec.copyConstructor) {
         for (int i = 0; i < vec.length; i++) {
             vec.copyConstructor(((uint8_t*) vec.items) + vec.typeSize * i, ((uint8_t*) vec.items) + vec.typeSize * (i + start));
@@ -69,7 +83,7 @@ vector SubVector(vector* v, size_t start, size_t end) {
 **/
 bool PushBackVector(vector* vector, void* valuePtr) {
     if (vector->length >= vector->size) {
-        void* temp = ReallocProper(&vector->items, vector->typeSize, vector->size * 2, vector->size, vector->copyConstructor);
+        void* temp = ReallocProper(vector->manager, &vector->items, vector->typeSize, vector->size * 2, vector->size, vector->copyConstructor);
         if (temp == NULL) return false;
         vector->size *= 2;
     }
@@ -111,7 +125,7 @@ void InsertVector(vector* vector, void* valuePtr, size_t index) {
 bool InjectVector(vector* vector, void* valuePtr, size_t index) {
     if (index >= vector->length) return false;
     if (vector->length >= vector->size) {
-        void* temp = ReallocProper(&vector->items, vector->typeSize, vector->size * 2, vector->size, vector->copyConstructor);
+        void* temp = ReallocProper(vector->manager, &vector->items, vector->typeSize, vector->size * 2, vector->size, vector->copyConstructor);
         if (temp == NULL) return false;
         vector->size *= 2;
     }
@@ -160,7 +174,7 @@ void RemoveVector(vector* vector, size_t index) {
 **/
 bool ShrinkVector(vector* vector) {
     if (vector->size - vector->length) {
-        void* temp = ShrinkAlloc(&vector->items, vector->typeSize, vector->length, vector->copyConstructor);
+        void* temp = ShrinkAlloc(vector->manager, &vector->items, vector->typeSize, vector->length, vector->copyConstructor);
         if (temp == NULL) return false;
         vector->size = vector->length;
     }
@@ -180,7 +194,7 @@ bool ReduceVector(vector* vector, size_t length) {
                 vector->destructor(((uint8_t*) vector->items) + vector->typeSize * i);
             }
         }
-        void* temp = ShrinkAlloc(&vector->items, vector->typeSize, length, vector->copyConstructor);
+        void* temp = ShrinkAlloc(vector->manager, &vector->items, vector->typeSize, length, vector->copyConstructor);
         if (temp == NULL) return false;
         vector->size = length;
         return true;
@@ -213,5 +227,5 @@ void DestroyVector(vector* vector) {
             vector->destructor(((uint8_t*) vector->items) + offset);
         }
     }
-    free(vector->items);
+    Free(vector->manager, vector->items);
 }
@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#include "../memory/manager.h"
+
 /**=================================================================|
  * A contiguous dynamic array.                                      |
  * =================================================================|
@@ -19,8 +21,10 @@
  *      used to move the data instead.                              |
  * void (*destructor)(void*) An optional parameter it's purpose is  |
  *      to clean up or destroy the underlying object.               |
+ * memory_manager* manager Where items is allocated from, NULL for  |
+ *      malloc.                                                     |
  * =================================================================|
- * Struct Size: 48 bytes on 64 bit systems and 24 on 32 bit systems.|
+ * Struct Size: 56 bytes on 64 bit systems and 28 on 32 bit systems.|
  * =================================================================|
 **/
 typedef struct vector {
@@ -28,9 +32,11 @@ typedef struct vector {
     void* items;
     void (*copyConstructor)(void*, void*);
     void (*destructor)(void*);
+    memory_manager* manager;
 } vector;
 
 vector ConstructVector(size_t typeSize, void (*copyConstruct)(void*, void*), void (*destructor)(void*));
+vector ConstructManagedVector(size_t typeSize, void (*copyConstruct)(void*, void*), void (*destructor)(void*), memory_manager* manager);
 vector DeepCopyVector(vector* vector);
 vector SubVector(vector* vector, size_t start, size_t end);
 bool PushBackVector(vector* vector, void* valuePtr);
@@ -0,0 +1,391 @@
+#define _GNU_SOURCE
+#include "wildcard.h"
+#include "string/str.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/**
+ * The record getdents64 fills its buffer with, glibc does not declare it.
+**/
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/**
+ * Hash a listing pointer by its device and inode.
+**/
+static size_t HashListing(const void* l) {
+    const dir_listing* listing = *(dir_listing* const*) l;
+    size_t key[2] = {listing->dev, listing->ino};
+    return HashBytes(key, sizeof(key));
+}
+
+/**
+ * Compare two listing pointers by their devices and inodes.
+**/
+static bool EqualsListing(const void* l1, const void* l2) {
+    const dir_listing* listing1 = *(dir_listing* const*) l1;
+    const dir_listing* listing2 = *(dir_listing* const*) l2;
+    return listing1->dev == listing2->dev && listing1->ino == listing2->ino;
+}
+
+/**
+ * Free a listing and its names.
+**/
+static void DestroyListing(void* l) {
+    dir_listing* listing = *(dir_listing**) l;
+    free(listing->names);
+    free(listing->entries);
+    free(listing);
+}
+
+/**
+ * Initialize an empty cache.
+**/
+void ConstructDirCache(dir_cache* cache) {
+    cache->listings = ConstructMap(sizeof(dir_listing*), HashListing, EqualsListing, NULL, DestroyListing);
+    cache->expansion = cache->clock = 0;
+    cache->reads = cache->hits = 0;
+}
+
+/**
+ * Find the end of the bracket expression starting at pattern[start], which is a '['.
+ * A ']' right after the '[' or "[!" is part of the set and the set cannot hold a '/' or whitespace.
+ * @return The index of the closing ']' or 0 if the '[' is not closed and so is just a '['.
+**/
+static size_t BracketEnd(const char* pattern, size_t length, size_t start) {
+    size_t i = start + 1;
+    if (i < length && (pattern[i] == '!' || pattern[i] == '^')) i++;
+    if (i < length && pattern[i] == ']') i++;
+    while (i < length && pattern[i] != ']' && pattern[i] != '/' && !isspace(pattern[i])) i++;
+    return i < length && pattern[i] == ']' ? i : 0;
+}
+
+/**
+ * Check if c is in the bracket expression pattern[start:end], end being its ']'.
+ * The set may be negated with '!' or '^' and may hold ranges like a-z.
+**/
+static bool InBracket(const char* pattern, size_t start, size_t end, char c) {
+    size_t i = start + 1;
+    bool negate = pattern[i] == '!' || pattern[i] == '^';
+    if (negate) i++;
+    bool found = false;
+    for (; i < end; i++) {
+        if (i + 2 < end && pattern[i + 1] == '-') {
+            found |= (unsigned char) pattern[i] <= (unsigned char) c && (unsigned char) c <= (unsigned char) pattern[i + 2];
+            i += 2;
+        } else {
+            found |= pattern[i] == c;
+        }
+    }
+    return found != negate;
+}
+
+/**
+ * Check if a word or line has a '*', '?' or closed bracket expression.
+ * The '?' of "$?" is a variable, not a wildcard.
+**/
+bool HasWildcards(const char* s, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (s[i] == '*' || (s[i] == '?' && (i == 0 || s[i - 1] != '$'))) return true;
+        if (s[i] == '[' && BracketEnd(s, length, i) != 0) return true;
+    }
+    return false;
+}
+
+/**
+ * Match a name against one component of a pattern. '*' matches any run of characters,
+ *    '?' any one character and [...] one character of the set.
+ * @param pattern The component, it does not need to be null-terminated.
+ * @param length The length of the component.
+ * @param name The null-terminated name.
+ * @return If the whole name matches the whole component.
+**/
+bool MatchWildcard(const char* pattern, size_t length, const char* name) {
+    // Where to retry from when a match after the last '*' fails.
+    size_t p = 0, n = 0, star = SIZE_MAX, starName = 0;
+    while (name[n]) {
+        if (p < length && pattern[p] == '*') {
+            star = ++p;
+            starName = n;
+            continue;
+        }
+        bool matched = false;
+        size_t next = p + 1;
+        if (p < length) {
+            size_t end = pattern[p] == '[' ? BracketEnd(pattern, length, p) : 0;
+            if (end != 0) {
+                matched = InBracket(pattern, p, end, name[n]);
+                next = end + 1;
+            } else {
+                matched = pattern[p] == '?' || pattern[p] == name[n];
+            }
+        }
+        if (matched) {
+            p = next;
+            n++;
+        } else if (star != SIZE_MAX) {
+            // Let the last '*' take one more character.
+            p = star;
+            n = ++starName;
+        } else {
+            return false;
+        }
+    }
+    while (p < length && pattern[p] == '*') p++;
+    return p == length;
+}
+
+/**
+ * Sort entries by name.
+**/
+static int CompareEntries(const void* e1, const void* e2) {
+    return strcmp(((const dir_entry*) e1)->name, ((const dir_entry*) e2)->name);
+}
+
+/**
+ * Read every name of a directory into a listing with getdents64, DIR_READ_SIZE bytes of records at a time.
+ * The mtime is taken before reading so a change made during the read is seen next time.
+ * @return false if the directory could not be read, the listing is left as it was.
+**/
+static bool ReadListing(dir_listing* listing, const char* path) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0) {
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    char* buffer = malloc(DIR_READ_SIZE);
+    size_t used = 0, size = 4096, count = 0, capacity = 64;
+    char* names = malloc(size);
+    dir_entry* entries = malloc(sizeof(dir_entry) * capacity);
+    long bytes;
+    while ((bytes = syscall(SYS_getdents64, fd, buffer, DIR_READ_SIZE)) > 0) {
+        for (long offset = 0; offset < bytes;) {
+            struct linux_dirent64* record = (struct linux_dirent64*) (buffer + offset);
+            offset += record->d_reclen;
+            if (strcmp(record->d_name, ".") == 0 || strcmp(record->d_name, "..") == 0) continue;
+            size_t length = strlen(record->d_name) + 1;
+            for (; used + length > size; size *= 2) names = realloc(names, size * 2);
+            if (count == capacity) entries = realloc(entries, sizeof(dir_entry) * (capacity *= 2));
+            memcpy(names + used, record->d_name, length);
+            // The block may still move so names are kept as offsets until it is done.
+            entries[count++] = (dir_entry) {(const char*) (uintptr_t) used, record->d_type};
+            used += length;
+        }
+    }
+    free(buffer);
+    close(fd);
+    if (bytes < 0) {
+        free(names);
+        free(entries);
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) entries[i].name = names + (uintptr_t) entries[i].name;
+    qsort(entries, count, sizeof(dir_entry), CompareEntries);
+
+    free(listing->names);
+    free(listing->entries);
+    listing->names = names;
+    listing->entries = entries;
+    listing->count = count;
+    listing->mtime = info.st_mtim;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    listing->racy = (now.tv_sec - info.st_mtim.tv_sec) * 1000 + (now.tv_nsec - info.st_mtim.tv_nsec) / 1000000 < DIR_RACY_MS;
+    return true;
+}
+
+/**
+ * Get the listing of a directory, reading it if it is not cached or has changed.
+ * A listing is read at most once per expansion so the listings being walked never change.
+ * @return The listing or NULL if path is not a readable directory.
+**/
+static dir_listing* GetListing(dir_cache* cache, const char* path) {
+    struct stat info;
+    if (stat(path, &info) < 0 || !S_ISDIR(info.st_mode)) return NULL;
+    dir_listing probe = {info.st_dev, info.st_ino}, *key = &probe;
+    dir_listing** found = GetMap(&cache->listings, &key);
+    dir_listing* listing = found ? *found : NULL;
+    bool current = listing && (listing->checked == cache->expansion
+        || (!listing->racy && listing->mtime.tv_sec == info.st_mtim.tv_sec && listing->mtime.tv_nsec == info.st_mtim.tv_nsec));
+    if (current) {
+        cache->hits++;
+    } else {
+        if (listing == NULL) {
+            listing = calloc(1, sizeof(dir_listing));
+            listing->dev = info.st_dev;
+            listing->ino = info.st_ino;
+            PutMap(&cache->listings, &listing);
+        }
+        if (!ReadListing(listing, path)) {
+            // Removing the pointer frees the listing.
+            RemoveMap(&cache->listings, &listing);
+            return NULL;
+        }
+        cache->reads++;
+    }
+    listing->checked = cache->expansion;
+    listing->used = ++cache->clock;
+    return listing;
+}
+
+/**
+ * Evict the least recently used listings until at most DIR_CACHE_SIZE are left.
+**/
+static void TrimDirCache(dir_cache* cache) {
+    while (cache->listings.length > DIR_CACHE_SIZE) {
+        size_t index = 0;
+        dir_listing** l, *oldest = NULL;
+        while ((l = NextMap(&cache->listings, &index)))
+            if (oldest == NULL || (*l)->used < oldest->used) oldest = *l;
+        RemoveMap(&cache->listings, &oldest);
+    }
+}
+
+/**
+ * Check if a matched name is a directory a pattern can go on into.
+**/
+static bool IsDirectory(const char* path, unsigned char type) {
+    struct stat info;
+    if (type == DT_DIR) return true;
+    // Links are followed like the shell does when it opens the path.
+    if (type != DT_LNK && type != DT_UNKNOWN) return false;
+    return stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+/**
+ * Add a copy of path to the matches.
+**/
+static void PushMatch(vector* matches, string* path, memory_manager* manager) {
+    string match;
+    ConstructManagedStr(&match, path->str, manager);
+    PushBackVector(matches, &match);
+}
+
+/**
+ * Match the rest of a pattern one '/' separated component at a time.
+ * Components without wildcards are taken as they are. A component with them is
+ *    matched against the listing of base, only matching hidden names if it starts with '.'.
+ * @param base The path matched so far, ending in '/' unless it is empty. It is restored before returning.
+ * @param rest The components left to match.
+**/
+static void Walk(dir_cache* cache, string* base, const char* rest, vector* matches, memory_manager* manager) {
+    const char* slash = strchr(rest, '/');
+    size_t length = slash ? (size_t) (slash - rest) : strlen(rest), baseLength = base->length;
+    if (!HasWildcards(rest, length)) {
+        AppendCStrN(base, rest, length);
+        struct stat info;
+        if (slash) {
+            AppendCStrN(base, "/", 1);
+            Walk(cache, base, slash + 1, matches, manager);
+        } else if (lstat(base->str, &info) == 0) {
+            PushMatch(matches, base, manager);
+        }
+    } else {
+        dir_listing* listing = GetListing(cache, baseLength > 0 ? base->str : ".");
+        // The names are sorted so only the run starting with the component's literal prefix is matched.
+        size_t prefix = 0, i = 0, high = listing ? listing->count : 0;
+        while (prefix < length && rest[prefix] != '*' && rest[prefix] != '?' && rest[prefix] != '[') prefix++;
+        while (i < high) {
+            size_t middle = i + (high - i) / 2;
+            if (strncmp(listing->entries[middle].name, rest, prefix) < 0) i = middle + 1;
+            else high = middle;
+        }
+        for (; listing && i < listing->count && strncmp(listing->entries[i].name, rest, prefix) == 0; i++) {
+            dir_entry* entry = listing->entries + i;
+            if ((entry->name[0] == '.' && rest[0] != '.') || !MatchWildcard(rest, length, entry->name)) continue;
+            AppendCStr(base, entry->name);
+            if (slash == NULL) {
+                PushMatch(matches, base, manager);
+            } else if (IsDirectory(base->str, entry->type)) {
+                AppendCStrN(base, "/", 1);
+                Walk(cache, base, slash + 1, matches, manager);
+            }
+            base->str[base->length = baseLength] = 0;
+        }
+    }
+    base->str[base->length = baseLength] = 0;
+}
+
+/**
+ * Add the paths matching a pattern to matches in sorted order.
+ * @param cache The directory listings to match against.
+ * @param pattern The pattern, its components are separated by '/'.
+ * @param matches A vector of strings to add to.
+ * @param manager Where the matched strings are allocated.
+ * @return The number of paths added.
+**/
+size_t ExpandWildcard(dir_cache* cache, const char* pattern, vector* matches, memory_manager* manager) {
+    TrimDirCache(cache);
+    cache->expansion++;
+    size_t count = matches->length;
+    string base;
+    ConstructStr(&base, "");
+    Walk(cache, &base, pattern, matches, manager);
+    DestroyStr(&base);
+    return matches->length - count;
+}
+
+/**
+ * Replace every arg with wildcards by the paths it matches.
+ * An arg matching nothing is left as it is written.
+ * @return The number of paths the args were replaced with.
+**/
+size_t ExpandWildcards(dir_cache* cache, vector* args) {
+    string* words = args->items;
+    size_t first = 0;
+    while (first < args->length && !HasWildcards(words[first].str, words[first].length)) first++;
+    if (first == args->length) return 0;
+
+    vector expanded = ConstructManagedVector(sizeof(string), args->copyConstructor, args->destructor, args->manager);
+    size_t count = 0;
+    for (size_t i = 0; i < args->length; i++) {
+        size_t found = i >= first && HasWildcards(words[i].str, words[i].length)
+            ? ExpandWildcard(cache, words[i].str, &expanded, args->manager) : 0;
+        if (found == 0) PushBackVector(&expanded, words + i);
+        else DestroyStr(words + i);
+        count += found;
+    }
+    // The old args were moved or destroyed so only the block is freed.
+    args->length = 0;
+    DestroyVector(args);
+    *args = expanded;
+    return count;
+}
+
+/**
+ * Print how many directories are cached and how often a listing was reused.
+**/
+void PrintDirCache(dir_cache* cache) {
+    size_t names = 0, index = 0;
+    dir_listing** l;
+    while ((l = NextMap(&cache->listings, &index))) names += (*l)->count;
+    printf("%zu directories with %zu names are cached, %zu reads and %zu hits.\n", cache->listings.length, names, cache->reads, cache->hits);
+}
+
+/**
+ * Forget every listing.
+**/
+void ClearDirCache(dir_cache* cache) {
+    ClearMap(&cache->listings);
+}
+
+/**
+ * Cleans up the cache.
+**/
+void DestroyDirCache(dir_cache* cache) {
+    DestroyMap(&cache->listings);
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#ifndef wildcard_h
+#define wildcard_h
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "map/map.h"
+#include "memory/manager.h"
+#include "vector/vector.h"
+
+// The size of the buffer each getdents64 call fills.
+#define DIR_READ_SIZE (256 * 1024)
+// The number of directory listings kept by the shell's directory cache.
+#define DIR_CACHE_SIZE 64
+// A directory changed this recently is listed again on every use since
+//    another change in the same mtime tick would not change its mtime.
+#define DIR_RACY_MS 1000
+
+/**=================================================================|
+ * A name in a directory listing.                                   |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * const char* name The name, it points into dir_listing::names.    |
+ * unsigned char type The d_type from getdents64, DT_UNKNOWN if the |
+ *      file system does not report it.                             |
+ * =================================================================|
+**/
+typedef struct dir_entry {
+    const char* name;
+    unsigned char type;
+} dir_entry;
+
+/**=================================================================|
+ * The sorted names of one directory.                               |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * A listing is keyed by the directory's device and inode, not its  |
+ * path, so it stays valid across cd and is shared by every path    |
+ * leading to the directory. It is used as long as the directory's  |
+ * mtime is the one it had when it was read.                        |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * dev_t dev The device of the directory.                           |
+ * ino_t ino The inode of the directory.                            |
+ * struct timespec mtime The mtime when the listing was read.       |
+ * bool racy If mtime was within DIR_RACY_MS of the read so the     |
+ *      listing is read again next time.                            |
+ * size_t checked The dir_cache::expansion the mtime was last       |
+ *      checked in.                                                 |
+ * size_t used When the listing was last used, for eviction.        |
+ * char* names Every name, null-terminated, in one block.           |
+ * dir_entry* entries The names sorted by strcmp without "." and    |
+ *      "..".                                                       |
+ * size_t count The number of entries.                              |
+ * =================================================================|
+**/
+typedef struct dir_listing {
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    bool racy;
+    size_t checked, used;
+    char* names;
+    dir_entry* entries;
+    size_t count;
+} dir_listing;
+
+/**=================================================================|
+ * A bounded cache of directory listings for wildcard expansion.    |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * The map holds pointers so a listing does not move while a        |
+ * pattern walks it. Each listing is checked against the directory  |
+ * with one stat per expansion and only read again with getdents64  |
+ * if it changed, so a glob over a large directory costs a stat and |
+ * a pass over its sorted names. Listings are only evicted between  |
+ * expansions.                                                      |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * map listings The dir_listing pointers keyed by device and inode. |
+ * size_t expansion The number of patterns expanded.                |
+ * size_t clock Counts listing uses for dir_listing::used.          |
+ * size_t reads The number of directories read with getdents64.     |
+ * size_t hits The number of listings used without a read.          |
+ * =================================================================|
+**/
+typedef struct dir_cache {
+    map listings;
+    size_t expansion, clock;
+    size_t reads, hits;
+} dir_cache;
+
+void ConstructDirCache(dir_cache* cache);
+bool HasWildcards(const char* line, size_t length);
+bool MatchWildcard(const char* pattern, size_t length, const char* name);
+size_t ExpandWildcard(dir_cache* cache, const char* pattern, vector* matches, memory_manager* manager);
+size_t ExpandWildcards(dir_cache* cache, vector* args);
+void PrintDirCache(dir_cache* cache);
+void ClearDirCache(dir_cache* cache);
+void DestroyDirCache(dir_cache* cache);
+#endif
\ No newline at end of file
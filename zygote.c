@@ -0,0 +1,286 @@
+#define _GNU_SOURCE
+#include "zygote.h"
+#include "launch.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/**=================================================================|
+ * The header of a message sent to a helper.                        |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * The header is followed by the null-terminated path, input file,  |
+ * output file, args and environment. The pipe ends, stderr and an  |
+ * O_PATH fd of the shell's working directory are passed as         |
+ * SCM_RIGHTS in that order, since the helper was cloned from a     |
+ * master that does not follow the shell's cd.                      |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * bool background If the command ignores SIGINT.                   |
+ * bool pipeIn, pipeOut If the stage reads or writes a pipe.        |
+ * bool error If the stage's stderr is redirected.                  |
+ * bool placed If the stage is pinned to cpus.                      |
+ * cpu_mask cpus The CPUs the stage runs on.                        |
+ * unsigned long nodes The NUMA nodes its memory is bound to.       |
+ * mode_t mask The shell's umask.                                   |
+ * size_t argc The number of args.                                  |
+ * size_t envc The number of environment entries.                   |
+ * =================================================================|
+**/
+typedef struct zygote_request {
+    bool background, pipeIn, pipeOut, error, placed;
+    cpu_mask cpus;
+    unsigned long nodes;
+    mode_t mask;
+    size_t argc, envc;
+} zygote_request;
+
+/**
+ * Take the next string of a message.
+**/
+static char* NextString(char** strings) {
+    char* s = *strings;
+    *strings += strlen(s) + 1;
+    return s;
+}
+
+/**
+ * The helper half of the pool. Waits for one message on socket and execs it
+ *    with ExecChild, so it behaves exactly like a forked child.
+ * Exits when the shell closes its end of the socket.
+**/
+static void RunZygote(int socket) {
+    ssize_t size = recv(socket, NULL, 0, MSG_PEEK | MSG_TRUNC);
+    if (size < (ssize_t) sizeof(zygote_request)) _exit(0);
+    char* message = malloc(size);
+    union {
+        struct cmsghdr header;
+        char data[CMSG_SPACE(sizeof(int) * 4)];
+    } control;
+    struct iovec iov = {message, size};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = &control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(socket, &msg, MSG_CMSG_CLOEXEC) != size) _exit(1);
+    int fds[4] = {-1, -1, -1, -1};
+    struct cmsghdr* header = CMSG_FIRSTHDR(&msg);
+    if (header && header->cmsg_type == SCM_RIGHTS) memcpy(fds, CMSG_DATA(header), header->cmsg_len - CMSG_LEN(0));
+
+    zygote_request* request = (zygote_request*) message;
+    char* strings = message + sizeof(zygote_request);
+    char* path = NextString(&strings);
+    command head;
+    ConstructEmptyCommand(&head, NULL);
+    SetCStr(&head.inOut[0], NextString(&strings));
+    SetCStr(&head.inOut[1], NextString(&strings));
+    char** args = malloc(sizeof(char*) * (request->argc + request->envc + 2));
+    char** envp = args + request->argc + 1;
+    for (size_t i = 0; i < request->argc; i++) args[i] = NextString(&strings);
+    for (size_t i = 0; i < request->envc; i++) envp[i] = NextString(&strings);
+    args[request->argc] = envp[request->envc] = NULL;
+
+    int errorFD = request->error ? fds[request->pipeIn + request->pipeOut] : -1;
+    // Run where the shell is now so relative paths and redirections resolve like a forked child's.
+    int cwd = fds[request->pipeIn + request->pipeOut + request->error];
+    if (fchdir(cwd) < 0) _exit(1);
+    close(cwd);
+    umask(request->mask);
+    launch_options options = {LAUNCH_FORK, request->background, envp, NULL, NULL, NULL, -1, errorFD, request->placed ? &request->cpus : NULL, request->nodes, NULL};
+    volatile int execError = 0;
+    ExecChild(&head, args, *path ? path : NULL, request->pipeIn ? fds[0] : -1, request->pipeOut ? fds[request->pipeIn] : -1, &options, &execError);
+}
+
+/**
+ * The master half of the pool. For every byte read from control a helper is
+ *    cloned with CLONE_PARENT so it is a child of the shell, not the master,
+ *    and its pid and socket are sent back to the shell.
+ * Exits when the shell closes control.
+**/
+static void RunMaster(int control) {
+    char request;
+    while (recv(control, &request, 1, 0) > 0) {
+        int ends[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, ends) < 0) continue;
+        pid_t pid = syscall(SYS_clone, CLONE_PARENT | SIGCHLD, NULL, NULL, NULL, NULL);
+        if (pid == 0) {
+            close(control);
+            close(ends[0]);
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            RunZygote(ends[1]);
+            _exit(1);
+        }
+        close(ends[1]);
+        union {
+            struct cmsghdr header;
+            char data[CMSG_SPACE(sizeof(int))];
+        } message;
+        struct iovec iov = {&pid, sizeof(pid)};
+        struct msghdr msg = {0};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        if (pid > 0) {
+            msg.msg_control = &message;
+            msg.msg_controllen = sizeof(message);
+            struct cmsghdr* header = CMSG_FIRSTHDR(&msg);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(header), ends, sizeof(int));
+        }
+        // A failed clone is still answered so the shell stops waiting for it.
+        sendmsg(control, &msg, MSG_NOSIGNAL);
+        close(ends[0]);
+    }
+    _exit(0);
+}
+
+/**
+ * Initialize an empty pool and fork its master, which is the only fork the
+ *    shell makes for the pool. Helpers are requested by FillZygotePool.
+ * Call once the shell's signals are blocked so the master inherits them.
+ * @param pool The pool to initialize.
+ * @param size The number of helpers to keep ready, 0 for no pool.
+**/
+void ConstructZygotePool(zygote_pool* pool, size_t size) {
+    pool->zygotes = NULL;
+    pool->size = pool->count = pool->requested = 0;
+    pool->master = -1;
+    int ends[2];
+    if (size == 0 || socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, ends) < 0) return;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(ends[0]);
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        RunMaster(ends[1]);
+    }
+    close(ends[1]);
+    if (pid < 0) {
+        close(ends[0]);
+        return;
+    }
+    pool->zygotes = malloc(sizeof(zygote) * size);
+    pool->size = size;
+    pool->master = ends[0];
+}
+
+/**
+ * Add the helpers the master has finished cloning to the pool without blocking.
+**/
+static void AdoptZygotes(zygote_pool* pool) {
+    while (pool->requested > 0) {
+        pid_t pid;
+        union {
+            struct cmsghdr header;
+            char data[CMSG_SPACE(sizeof(int))];
+        } message;
+        struct iovec iov = {&pid, sizeof(pid)};
+        struct msghdr msg = {0};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = &message;
+        msg.msg_controllen = sizeof(message);
+        if (recvmsg(pool->master, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC) <= 0) break;
+        pool->requested--;
+        struct cmsghdr* header = CMSG_FIRSTHDR(&msg);
+        if (pid <= 0 || header == NULL || header->cmsg_type != SCM_RIGHTS) continue;
+        zygote z = {pid, -1};
+        memcpy(&z.socket, CMSG_DATA(header), sizeof(int));
+        pool->zygotes[pool->count++] = z;
+    }
+}
+
+/**
+ * Adopt the helpers that are ready and ask the master for enough new ones to
+ *    fill the pool. The master clones them while the shell keeps running so
+ *    this never forks.
+ * @return The number of idle helpers.
+**/
+size_t FillZygotePool(zygote_pool* pool) {
+    if (pool->master < 0) return 0;
+    AdoptZygotes(pool);
+    for (; pool->count + pool->requested < pool->size; pool->requested++) {
+        if (send(pool->master, "z", 1, MSG_NOSIGNAL | MSG_DONTWAIT) < 0) break;
+    }
+    return pool->count;
+}
+
+/**
+ * Hand a stage to an idle helper which execs it.
+ * The arguments are the same as for a forked child, see ExecChild.
+ * @return The pid of the helper running the command or -1 if no helper
+ *    is ready, in which case the caller should fork instead.
+**/
+pid_t LaunchZygote(zygote_pool* pool, command* head, char** args, const char* path, int pipeIn, int pipeOut, int errorFD, bool background, const cpu_mask* cpus, unsigned long nodes, char** envp) {
+    // The helper does not share the shell's working directory so it gets a handle to it.
+    int cwd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (cwd < 0) return -1;
+    zygote_request request = {background, pipeIn >= 0, pipeOut >= 0, errorFD >= 0, cpus != NULL, {{0}}, nodes, umask(0), 0, 0};
+    umask(request.mask);
+    if (cpus) request.cpus = *cpus;
+    size_t size = strlen(path ? path : "") + head->inOut[0].length + head->inOut[1].length + 3;
+    for (; args[request.argc]; request.argc++) size += strlen(args[request.argc]) + 1;
+    for (; envp[request.envc]; request.envc++) size += strlen(envp[request.envc]) + 1;
+    char* strings = malloc(size), *end = strings;
+    end = stpcpy(end, path ? path : "") + 1;
+    end = stpcpy(end, head->inOut[0].str) + 1;
+    end = stpcpy(end, head->inOut[1].str) + 1;
+    for (size_t i = 0; i < request.argc; i++) end = stpcpy(end, args[i]) + 1;
+    for (size_t i = 0; i < request.envc; i++) end = stpcpy(end, envp[i]) + 1;
+
+    int fds[4], count = 0;
+    if (pipeIn >= 0) fds[count++] = pipeIn;
+    if (pipeOut >= 0) fds[count++] = pipeOut;
+    if (errorFD >= 0) fds[count++] = errorFD;
+    fds[count++] = cwd;
+    union {
+        struct cmsghdr header;
+        char data[CMSG_SPACE(sizeof(int) * 4)];
+    } control;
+    struct iovec iov[2] = {{&request, sizeof(request)}, {strings, size}};
+    struct msghdr msg = {0};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_control = &control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+    struct cmsghdr* header = CMSG_FIRSTHDR(&msg);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int) * count);
+    memcpy(CMSG_DATA(header), fds, sizeof(int) * count);
+
+    pid_t pid = -1;
+    AdoptZygotes(pool);
+    while (pid < 0 && pool->count > 0) {
+        zygote* z = pool->zygotes + pool->count - 1;
+        if (sendmsg(z->socket, &msg, MSG_NOSIGNAL) >= 0) pid = z->pid;
+        // A message that is too big would fail for every helper so keep this one.
+        else if (errno == EMSGSIZE || errno == ENOBUFS) break;
+        // Otherwise the helper died and was reaped as an unknown child.
+        close(z->socket);
+        pool->count--;
+    }
+    free(strings);
+    close(cwd);
+    // Replace the helper while the command runs.
+    FillZygotePool(pool);
+    return pid;
+}
+
+/**
+ * Close the master's and every helper's socket which makes them exit and clean up the pool.
+**/
+void DestroyZygotePool(zygote_pool* pool) {
+    if (pool->master >= 0) close(pool->master);
+    for (size_t i = 0; i < pool->count; i++) close(pool->zygotes[i].socket);
+    free(pool->zygotes);
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef zygote_h
+#define zygote_h
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include "command.h"
+#include "placement.h"
+
+// The number of helpers kept ready by the zygote backend.
+#define ZYGOTE_POOL_SIZE 4
+
+/**=================================================================|
+ * A pre-forked helper waiting for a command to exec.               |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * pid_t pid The helper's pid, which becomes the command's pid.     |
+ * int socket The shell's end of the helper's socket.               |
+ * =================================================================|
+**/
+typedef struct zygote {
+    pid_t pid;
+    int socket;
+} zygote;
+
+/**=================================================================|
+ * A pool of pre-forked helpers that exec commands for the shell.   |
+ * =================================================================|
+ * >>> Special Information.                                         |
+ * Each helper is blocked on a SOCK_SEQPACKET socket. A launch      |
+ * sends it the argv, environment, redirections and pipe ends of a  |
+ * stage and it execs right away, so no fork happens when a command |
+ * is submitted. Helpers are cloned by a master process forked once |
+ * with the pool. The master uses CLONE_PARENT so helpers are the   |
+ * shell's children and their pids are reaped like any other, and   |
+ * it clones them while the shell goes on running commands.         |
+ * =================================================================|
+ * >>> Member Information.                                          |
+ * zygote* zygotes The idle helpers, used from the end.             |
+ * size_t size The number of helpers FillZygotePool keeps ready.    |
+ * size_t count The number of idle helpers.                         |
+ * size_t requested The helpers asked of the master not yet adopted.|
+ * int master The shell's end of the master's socket or -1.         |
+ * =================================================================|
+**/
+typedef struct zygote_pool {
+    zygote* zygotes;
+    size_t size, count, requested;
+    int master;
+} zygote_pool;
+
+void ConstructZygotePool(zygote_pool* pool, size_t size);
+size_t FillZygotePool(zygote_pool* pool);
+pid_t LaunchZygote(zygote_pool* pool, command* head, char** args, const char* path, int pipeIn, int pipeOut, int errorFD, bool background, const cpu_mask* cpus, unsigned long nodes, char** envp);
+void DestroyZygotePool(zygote_pool* pool);
+#endif
\ No newline at end of file